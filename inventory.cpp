@@ -0,0 +1,3259 @@
+#include "inventory.h"
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <chrono>
+#include <mutex>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+Money Money::fromDouble(double amount) {
+	return fromCents(llround(amount * 100));
+}
+
+bool Money::parse(string_view text, Money& amount) {
+	size_t point = text.find('.');
+	string_view whole = text.substr(0, point);
+	string_view fraction = point == string_view::npos ? string_view() : text.substr(point + 1);
+	int64_t units = 0, hundredths = 0;
+	if ((whole.empty() && fraction.empty()) || fraction.size() > 2) {
+		return false;
+	}
+	if ((!whole.empty() && !parseNumber(whole, units)) || (!fraction.empty() && !parseNumber(fraction, hundredths))) {
+		return false;
+	}
+	if (fraction.size() == 1) {
+		hundredths *= 10; // ".5" is fifty cents
+	}
+	if (units > (numeric_limits<int64_t>::max() - hundredths) / 100) {
+		return false;
+	}
+	amount = fromCents(units * 100 + hundredths);
+	return true;
+}
+
+bool Money::parsePrice(string_view text, Money& price) {
+	Money amount;
+	if (!parse(text, amount) || !amount.isValidPrice()) {
+		return false;
+	}
+	price = amount;
+	return true;
+}
+
+// The buffer must hold maxFormattedLength characters
+char* Money::format(char* first, char* last) const {
+	uint64_t magnitude = cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+	if (cents < 0) {
+		*first++ = '-';
+	}
+	first = to_chars(first, last, magnitude / 100).ptr;
+	first[0] = '.';
+	first[1] = static_cast<char>('0' + magnitude / 10 % 10);
+	first[2] = static_cast<char>('0' + magnitude % 10);
+	return first + 3;
+}
+
+string Money::toString() const {
+	char buffer[maxFormattedLength];
+	return string(buffer, format(buffer, buffer + sizeof(buffer)));
+}
+
+MoneyTotal& MoneyTotal::addTimes(Money amount, uint32_t count) {
+	int64_t cents = amount.getCents();
+	uint64_t magnitude = cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+	// Multiplies each 32-bit half of the magnitude, neither product can overflow
+	uint64_t lowProduct = (magnitude & 0xFFFFFFFF) * count, highProduct = (magnitude >> 32) * count;
+	uint64_t productLow = lowProduct + (highProduct << 32);
+	uint64_t productHigh = (highProduct >> 32) + (productLow < lowProduct);
+	if (cents < 0) {
+		productLow = ~productLow + 1;
+		productHigh = ~productHigh + (productLow == 0);
+	}
+	addWide(productLow, productHigh);
+	return *this;
+}
+
+Money MoneyTotal::toMoney() const {
+	if (fitsMoney()) {
+		return Money::fromCents(static_cast<int64_t>(low));
+	}
+	return Money::fromCents(static_cast<int64_t>(high) < 0 ? numeric_limits<int64_t>::min() : numeric_limits<int64_t>::max());
+}
+
+string MoneyTotal::toString() const {
+	if (fitsMoney()) {
+		return toMoney().toString();
+	}
+
+	// Divides the magnitude by 10^9 a 32-bit limb at a time, most significant limb first
+	bool negative = static_cast<int64_t>(high) < 0;
+	uint64_t magnitudeLow = negative ? ~low + 1 : low, magnitudeHigh = negative ? ~high + (low == 0) : high;
+	uint32_t limbs[4] = {static_cast<uint32_t>(magnitudeHigh >> 32), static_cast<uint32_t>(magnitudeHigh),
+	                     static_cast<uint32_t>(magnitudeLow >> 32), static_cast<uint32_t>(magnitudeLow)};
+	string digits;
+	while (limbs[0] != 0 || limbs[1] != 0 || limbs[2] != 0 || limbs[3] != 0) {
+		uint64_t remainder = 0;
+		for (uint32_t& limb : limbs) {
+			uint64_t current = (remainder << 32) | limb;
+			limb = static_cast<uint32_t>(current / 1000000000);
+			remainder = current % 1000000000;
+		}
+		for (int i = 0; i < 9; i++) {
+			digits += static_cast<char>('0' + remainder % 10);
+			remainder /= 10;
+		}
+	}
+	// Outside the Money range there are always more than three digits
+	digits.erase(digits.find_last_not_of('0') + 1);
+	digits.insert(2, 1, '.');
+	if (negative) {
+		digits += '-';
+	}
+	return string(digits.rbegin(), digits.rend());
+}
+
+// Copies the text into the pool, or reuses an equal entry when interning
+uint32_t StringColumn::intern(string_view text) {
+	uint32_t entry;
+	if (!freeEntries.empty()) {
+		entry = freeEntries.back();
+		freeEntries.pop_back();
+	} else {
+		entry = static_cast<uint32_t>(entries.size());
+		entries.push_back({});
+	}
+	size_t poolEnd = pool.size();
+	pool.append(text.data(), text.size());
+	entries[entry] = {poolEnd, static_cast<uint32_t>(text.size()), 1};
+
+	if (internStrings) {
+		auto inserted = interned.insert(entry);
+		if (!inserted.second) {
+			// Already stored, drop the provisional copy
+			pool.resize(poolEnd);
+			entries[entry].references = 0;
+			freeEntries.push_back(entry);
+			entry = *inserted.first;
+			entries[entry].references++;
+		}
+	}
+	return entry;
+}
+
+void StringColumn::release(uint32_t entry) {
+	if (--entries[entry].references > 0) {
+		return;
+	}
+	if (internStrings) {
+		interned.erase(entry);
+	}
+	deadBytes += entries[entry].length;
+	freeEntries.push_back(entry);
+	if (deadBytes > (1 << 20) && deadBytes > pool.size() / 2) {
+		compact();
+	}
+}
+
+// Rewrites the pool without the text of released entries
+void StringColumn::compact() {
+	string compacted;
+	compacted.reserve(pool.size() - deadBytes);
+	for (Entry& entry : entries) {
+		if (entry.references > 0) {
+			size_t offset = compacted.size();
+			compacted.append(pool, entry.offset, entry.length);
+			entry.offset = offset;
+		} else {
+			entry.offset = 0;
+			entry.length = 0;
+		}
+	}
+	pool.swap(compacted);
+	deadBytes = 0;
+}
+
+void StringColumn::clear() {
+	pool.clear();
+	entries.clear();
+	freeEntries.clear();
+	rows.clear();
+	interned.clear();
+	deadBytes = 0;
+}
+
+// Validations
+bool Inventory::isValidID(string_view id) {
+	if (id.empty()) {
+		return false; // Empty string is invalid
+	}
+
+	for (unsigned char c : id) {
+		if (!isalnum(c) || isspace(c)) {
+			return false; // Return false if any character is not alphanumeric
+		}
+	}
+	return true;
+}
+
+bool Inventory::isIDTaken(const string& fullID) {
+	return findItem(fullID) != nullptr;
+}
+
+// Index lookup, expects the lowercase ID
+Item* Inventory::findItem(const string& id) const {
+	size_t row = findRow(id);
+	return row != string::npos ? itemStorage[row] : nullptr;
+}
+
+const Item* Inventory::getItem(const string& id) const {
+	INVENTORY_METRIC(Lookup);
+	string key = id;
+	toLowerCase(key);
+	return findItem(key);
+}
+
+size_t Inventory::findRow(const string& id) const {
+	auto found = itemIndex.find(id);
+	return found != itemIndex.end() ? slots[found->second].row : string::npos;
+}
+
+ItemHandle Inventory::findHandle(const string& id) const {
+	string key = id;
+	toLowerCase(key);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	auto found = itemIndex.find(key);
+	if (found == itemIndex.end()) {
+		return {numeric_limits<uint32_t>::max(), 0};
+	}
+	return {found->second, slots[found->second].generation};
+}
+
+// Returns nullptr once the item behind the handle has been removed
+Item* Inventory::resolve(ItemHandle handle) const {
+	if (handle.slot >= slots.size() || slots[handle.slot].generation != handle.generation) {
+		return nullptr;
+	}
+	return itemStorage[slots[handle.slot].row];
+}
+
+bool Inventory::lookupItem(const string& id, ItemRecord& record) const {
+	INVENTORY_METRIC(Lookup);
+	string key = id;
+	toLowerCase(key);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	size_t row = findRow(key);
+	if (row == string::npos) {
+		return false;
+	}
+	record.id = idColumn[row];
+	record.name = nameColumn[row];
+	record.quantity = liveQuantities[rowSlots[row]].quantity.load(memory_order_relaxed);
+	record.price = priceColumn[row];
+	record.category = categoryColumn[row];
+	return true;
+}
+
+// Copies of the items a query returned, the caller holds the lock at least shared
+vector<ItemRecord> Inventory::copyRecords(const vector<Item*>& items) {
+	vector<ItemRecord> records(items.size());
+	for (size_t i = 0; i < items.size(); i++) {
+		const Item* item = items[i];
+		ItemRecord& record = records[i];
+		record.id = item->getItemID();
+		record.name = item->getItemName();
+		record.quantity = item->getItemQuantity();
+		record.price = item->getItemPrice();
+		record.category = item->getCategoryTag();
+	}
+	return records;
+}
+
+bool Inventory::insertItem(CategoryTag tag, const string& id, const string& name, int quantity, Money price) {
+	INVENTORY_METRIC(Insert);
+	if (!isValidID(id) || name.empty() || quantity < 0 || !price.isValidPrice()) {
+		return false;
+	}
+	string key = id;
+	toLowerCase(key);
+	string itemName = capitalizeFirstLetter(name); // Same form as every other way in, prefix search relies on it
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	if (isIDTaken(key)) {
+		return false;
+	}
+	storeItem(createItem(tag, key, itemName, quantity, price));
+	return true;
+}
+
+bool Inventory::updateQuantity(const string& id, int quantity) {
+	INVENTORY_METRIC(Update);
+	string key = id;
+	toLowerCase(key);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	Item* item = findItem(key);
+	if (item == nullptr || quantity < 0) {
+		return false;
+	}
+	setItemQuantity(item, quantity);
+	return true;
+}
+
+bool Inventory::updatePrice(const string& id, Money price) {
+	INVENTORY_METRIC(Update);
+	string key = id;
+	toLowerCase(key);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	Item* item = findItem(key);
+	if (item == nullptr || !price.isValidPrice()) {
+		return false;
+	}
+	setItemPrice(item, price);
+	return true;
+}
+
+bool Inventory::updateReorderLevel(const string& id, int reorderLevel) {
+	INVENTORY_METRIC(Update);
+	string key = id;
+	toLowerCase(key);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	Item* item = findItem(key);
+	if (item == nullptr || reorderLevel < useCategoryReorderLevel) {
+		return false;
+	}
+	setItemReorderLevel(item, reorderLevel);
+	return true;
+}
+
+bool Inventory::eraseItem(const string& id) {
+	INVENTORY_METRIC(Remove);
+	string key = id;
+	toLowerCase(key);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	Item* item = findItem(key);
+	if (item == nullptr) {
+		return false;
+	}
+	unstoreItem(item);
+	destroyItem(item);
+	return true;
+}
+
+size_t Inventory::itemCount() const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return itemStorage.size();
+}
+
+// The caller holds the lock at least shared, so the slot cannot be removed meanwhile
+bool Inventory::adjustLiveQuantity(uint32_t slot, int delta, bool floorAtZero, int* newQuantity) {
+	LiveQuantity& live = liveQuantities[slot];
+	// A quantity never wraps around, a delta that would leave the int range is refused like one below zero
+	const long long lowest = floorAtZero ? 0 : numeric_limits<int>::min();
+	int current = live.quantity.load(memory_order_relaxed);
+	long long wanted;
+	do {
+		wanted = static_cast<long long>(current) + delta;
+		if (wanted < lowest || wanted > numeric_limits<int>::max()) {
+			return false;
+		}
+	} while (!live.quantity.compare_exchange_weak(current, static_cast<int>(wanted), memory_order_relaxed));
+	int quantity = static_cast<int>(wanted);
+
+	// First adjustment since the last fold, queue the slot
+	if (!live.pending.load(memory_order_relaxed) && !live.pending.exchange(true, memory_order_relaxed)) {
+		uint32_t head = pendingAdjustments.load(memory_order_relaxed);
+		do {
+			live.nextPending = head;
+		} while (!pendingAdjustments.compare_exchange_weak(head, slot, memory_order_release, memory_order_relaxed));
+	}
+	if (newQuantity != nullptr) {
+		*newQuantity = quantity;
+	}
+	return true;
+}
+
+bool Inventory::adjustQuantity(const string& id, int delta, int* newQuantity) {
+	INVENTORY_METRIC(Adjust);
+	string key = id;
+	toLowerCase(key);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	auto found = itemIndex.find(key);
+	return found != itemIndex.end() && adjustLiveQuantity(found->second, delta, false, newQuantity);
+}
+
+bool Inventory::tryAdjustQuantity(const string& id, int delta, int* newQuantity) {
+	INVENTORY_METRIC(Adjust);
+	string key = id;
+	toLowerCase(key);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	auto found = itemIndex.find(key);
+	return found != itemIndex.end() && adjustLiveQuantity(found->second, delta, true, newQuantity);
+}
+
+bool Inventory::adjustQuantity(ItemHandle handle, int delta, int* newQuantity) {
+	INVENTORY_METRIC(Adjust);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return resolve(handle) != nullptr && adjustLiveQuantity(handle.slot, delta, false, newQuantity);
+}
+
+bool Inventory::tryAdjustQuantity(ItemHandle handle, int delta, int* newQuantity) {
+	INVENTORY_METRIC(Adjust);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return resolve(handle) != nullptr && adjustLiveQuantity(handle.slot, delta, true, newQuantity);
+}
+
+// Runs with the lock held exclusively, so no adjustment races the fold
+void Inventory::applyPendingAdjustments() {
+	uint32_t slot = pendingAdjustments.exchange(noPendingSlot, memory_order_acquire);
+	while (slot != noPendingSlot) {
+		LiveQuantity& live = liveQuantities[slot];
+		uint32_t next = live.nextPending;
+		live.pending.store(false, memory_order_relaxed);
+		size_t row = slots[slot].row;
+		if (row < rowSlots.size() && rowSlots[row] == slot && live.quantity.load(memory_order_relaxed) != quantityColumn[row]) {
+			setItemQuantity(itemStorage[row], live.quantity.load(memory_order_relaxed));
+		}
+		slot = next;
+	}
+}
+
+bool Inventory::commitChanges(string& error) {
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	return syncLog(error);
+}
+
+// Cross-checks the items against every index, used by the stress test
+bool Inventory::verifyIndexes(string& error) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	size_t count = itemStorage.size();
+	if (itemIndex.size() != count || rowSlots.size() != count || quantityColumn.size() != count || priceColumn.size() != count ||
+	    categoryColumn.size() != count || idColumn.size() != count || nameColumn.size() != count ||
+	    priceView.size() != count || quantityView.size() != count || nameView.size() != count) {
+		error = "index sizes differ from the item count " + to_string(count);
+		return false;
+	}
+
+	CategoryStats totals[categoryCount];
+	size_t lowCount = 0;
+	for (size_t row = 0; row < count; row++) {
+		const Item* item = itemStorage[row];
+		uint32_t slot = rowSlots[row];
+		auto found = itemIndex.find(item->getItemID());
+		if (slots[slot].row != row || found == itemIndex.end() || found->second != slot) {
+			error = "slot of row " + to_string(row) + " is out of date";
+			return false;
+		}
+		if (quantityColumn[row] != item->getItemQuantity() || priceColumn[row] != item->getItemPrice() ||
+		    categoryColumn[row] != getCategoryTag(item) || idColumn[row] != item->getItemID() || nameColumn[row] != item->getItemName()) {
+			error = "columns of row " + to_string(row) + " differ from item " + item->getItemID();
+			return false;
+		}
+		if (pendingAdjustments.load() == noPendingSlot && liveQuantities[slot].quantity.load() != quantityColumn[row]) {
+			error = "live quantity of item " + item->getItemID() + " was never folded in";
+			return false;
+		}
+		CategoryStats& stats = totals[static_cast<size_t>(categoryColumn[row])];
+		stats.itemCount++;
+		stats.totalQuantity += quantityColumn[row];
+		stats.totalValue += priceColumn[row] * quantityColumn[row];
+
+		bool low = quantityColumn[row] <= getReorderLevel(item);
+		if (low != (slots[slot].lowStockPosition != notLowStock)) {
+			error = "low-stock state of item " + item->getItemID() + " is out of date";
+			return false;
+		}
+		lowCount += low;
+	}
+	if (lowCount != lowStockSlots.size()) {
+		error = "low-stock set holds " + to_string(lowStockSlots.size()) + " items instead of " + to_string(lowCount);
+		return false;
+	}
+	for (size_t i = 0; i < categoryCount; i++) {
+		const CategoryStats& kept = buckets[i].stats;
+		if (kept.itemCount != totals[i].itemCount || buckets[i].slots.size() != totals[i].itemCount || kept.totalQuantity != totals[i].totalQuantity ||
+		    kept.totalValue != totals[i].totalValue) {
+			error = string("totals of ") + categoryTable[i].name + " are out of date";
+			return false;
+		}
+	}
+	return true;
+}
+
+// Rough bytes held for one category's items: the objects, their column rows, index entries and name postings
+// Strings longer than the small-string buffer are counted once per copy, node sizes assume a typical 64-bit library
+uint64_t Inventory::categoryMemory(CategoryTag tag) const {
+	const size_t treeNode = 4 * sizeof(void*); // Colour, parent and two children
+	const size_t hashNode = 2 * sizeof(void*); // Next pointer and bucket slot
+	auto heapBytes = [](size_t length) {
+		return length > 15 ? length + 1 : 0;
+	};
+	size_t fixed = CategoryPools::itemSize(tag) + sizeof(ItemSlot) + sizeof(LiveQuantity) + sizeof(Item*) + sizeof(int) + sizeof(Money) + sizeof(CategoryTag)
+	             + 3 * sizeof(uint32_t) // rowSlots, bucket and low-stock positions
+	             + 2 * (sizeof(uint32_t) + 16) // ID and name column rows and entries
+	             + 3 * treeNode + sizeof(Money) + sizeof(int) + sizeof(string) + 3 * sizeof(Item*) // Ordered views
+	             + hashNode + sizeof(string) + sizeof(uint32_t); // ID index
+
+	uint64_t total = 0;
+	for (uint32_t slot : buckets[static_cast<size_t>(tag)].slots) {
+		const Item* item = itemStorage[slots[slot].row];
+		size_t idLength = item->getItemID().size(), nameLength = item->getItemName().size();
+		total += fixed + idLength + nameLength // Column pools
+		       + 2 * heapBytes(idLength) + 2 * heapBytes(nameLength) // Item and index copies
+		       + (nameLength > 2 ? (nameLength - 2) * sizeof(Posting) : 0);
+	}
+	return total;
+}
+
+MetricsReport Inventory::metricsReport() const {
+	MetricsReport report;
+#if INVENTORY_METRICS
+	for (size_t i = 0; i < metricOperationCount; i++) {
+		MetricOperation operation = static_cast<MetricOperation>(i);
+		uint64_t calls = metrics.calls(operation);
+		if (calls == 0) {
+			continue;
+		}
+		const LatencyHistogram& histogram = metrics.histogram(operation);
+		report.operations.push_back({getMetricOperationName(operation), calls, histogram.count(), histogram.mean(),
+		                             histogram.percentile(0.5), histogram.percentile(0.99), histogram.percentile(0.999), histogram.max()});
+	}
+#endif
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	for (const CategoryInfo& info : categoryTable) {
+		report.categories.push_back({info.name, getCategoryStats(info.tag).itemCount, categoryMemory(info.tag)});
+	}
+	return report;
+}
+
+// Valuation blocks are also compiled for AVX-512 and AVX2, picked at run time by what the processor has
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define INVENTORY_VECTOR_CLONES __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#else
+#define INVENTORY_VECTOR_CLONES
+#endif
+
+// Adds the totals of other rows, empty totals leave the price range alone
+static void mergeValuation(ValuationTotals& totals, const ValuationTotals& other) {
+	if (other.itemCount == 0) {
+		return;
+	}
+	if (totals.itemCount == 0) {
+		totals = other;
+		return;
+	}
+	totals.itemCount += other.itemCount;
+	totals.totalQuantity += other.totalQuantity;
+	totals.totalValue += other.totalValue;
+	totals.priceSum += other.priceSum;
+	totals.minPrice = min(totals.minPrice, other.minPrice);
+	totals.maxPrice = max(totals.maxPrice, other.maxPrice);
+}
+
+// Totals of the rows of one category within a block
+// Rows of other categories are masked out instead of branched over, so the compiler turns the loop into SIMD code
+// Prices fit 32 bits, see maxPriceCents, so stock values are widening 32-bit multiplies
+// Each stock value is split at bit 31, so neither block sum of the halves can overflow, and the halves meet in a MoneyTotal
+INVENTORY_VECTOR_CLONES
+static void valuateBlock(const int* quantities, const Money* prices, const CategoryTag* categories, size_t rowCount,
+                         CategoryTag tag, ValuationTotals& totals) {
+	const int32_t none = numeric_limits<int32_t>::max();
+	int32_t items = 0, low = none, high = 0;
+	int64_t quantity = 0, lowValue = 0, highValue = 0, priceSum = 0;
+	for (size_t row = 0; row < rowCount; row++) {
+		int32_t mask = -static_cast<int32_t>(categories[row] == tag); // All ones for the rows of the category
+		int32_t price = static_cast<int32_t>(prices[row].getCents()) & mask;
+		int32_t rowQuantity = quantities[row] & mask;
+		items -= mask;
+		quantity += rowQuantity;
+		int64_t value = static_cast<int64_t>(price) * rowQuantity;
+		lowValue += value & 0x7FFFFFFF;
+		highValue += value >> 31;
+		priceSum += price;
+		int32_t lowPrice = price | (~mask & none);
+		low = lowPrice < low ? lowPrice : low;
+		high = price > high ? price : high;
+	}
+
+	ValuationTotals block;
+	block.itemCount = static_cast<size_t>(items);
+	block.totalQuantity = quantity;
+	block.totalValue.addTimes(Money::fromCents(highValue), uint32_t(1) << 31);
+	block.totalValue += Money::fromCents(lowValue);
+	block.priceSum = Money::fromCents(priceSum);
+	block.minPrice = Money::fromCents(low);
+	block.maxPrice = Money::fromCents(high);
+	mergeValuation(totals, block);
+}
+
+// Per-category totals of a range of rows on the calling thread
+// Every category makes its own pass over a block while the block is still in the L1 cache
+static void valuateRows(const int* quantities, const Money* prices, const CategoryTag* categories, size_t rowCount, ValuationTotals* totals) {
+	const size_t blockRows = 2048;
+	for (size_t start = 0; start < rowCount; start += blockRows) {
+		size_t count = min(blockRows, rowCount - start);
+		for (const CategoryInfo& info : categoryTable) {
+			valuateBlock(quantities + start, prices + start, categories + start, count, info.tag, totals[static_cast<size_t>(info.tag)]);
+		}
+	}
+}
+
+InventoryValuation Inventory::valuateColumns(const int* quantities, const Money* prices, const CategoryTag* categories, size_t rowCount, size_t threadCount) {
+	if (rowCount < parallelValuationThreshold) {
+		threadCount = 1;
+	} else if (threadCount == 0) {
+		threadCount = max<size_t>(1, thread::hardware_concurrency());
+	}
+
+	// Each thread scans one range of rows into its own totals, the calling thread takes the first
+	vector<InventoryValuation> partial(threadCount);
+	size_t chunkSize = (rowCount + threadCount - 1) / threadCount;
+	vector<thread> workers;
+	for (size_t i = 1; i < threadCount; i++) {
+		size_t start = min(rowCount, i * chunkSize), end = min(rowCount, start + chunkSize);
+		workers.emplace_back([=, &partial]() {
+			valuateRows(quantities + start, prices + start, categories + start, end - start, partial[i].categories);
+		});
+	}
+	valuateRows(quantities, prices, categories, min(rowCount, chunkSize), partial[0].categories);
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	InventoryValuation valuation;
+	for (size_t c = 0; c < categoryCount; c++) {
+		for (const InventoryValuation& part : partial) {
+			mergeValuation(valuation.categories[c], part.categories[c]);
+		}
+		mergeValuation(valuation.overall, valuation.categories[c]);
+	}
+	return valuation;
+}
+
+InventoryValuation Inventory::valuation() const {
+	INVENTORY_METRIC(Valuation);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return valuateColumns(quantityColumn.data(), priceColumn.data(), categoryColumn.data(), categoryColumn.size());
+}
+
+void Inventory::storeItem(Item* item, bool logged) {
+	if (logged) {
+		logMutation(LogOperation::Add, item);
+	}
+	uint32_t slot;
+	if (!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	} else {
+		slot = static_cast<uint32_t>(slots.size());
+		slots.push_back({0, 0, 0, useCategoryReorderLevel, notLowStock, 0});
+		liveQuantities.emplace_back();
+	}
+	liveQuantities[slot].quantity.store(item->getItemQuantity(), memory_order_relaxed);
+	slots[slot].reorderLevel = useCategoryReorderLevel;
+	slots[slot].lowStockPosition = notLowStock;
+	CategoryTag tag = getCategoryTag(item);
+	CategoryBucket& bucket = buckets[static_cast<size_t>(tag)];
+	slots[slot].row = static_cast<uint32_t>(itemStorage.size());
+	slots[slot].bucketPosition = static_cast<uint32_t>(bucket.slots.size());
+	bucket.slots.push_back(slot);
+	bucket.stats.itemCount++;
+	bucket.stats.totalQuantity += item->getItemQuantity();
+	bucket.stats.totalValue += item->getItemPrice() * item->getItemQuantity();
+	rowSlots.push_back(slot);
+	itemIndex.emplace(item->getItemID(), slot);
+	itemStorage.push_back(item);
+	quantityColumn.push_back(item->getItemQuantity());
+	priceColumn.push_back(item->getItemPrice());
+	categoryColumn.push_back(tag);
+	idColumn.push_back(item->getItemID());
+	nameColumn.push_back(item->getItemName());
+	slots[slot].priceEntry = priceView.emplace(item->getItemPrice(), item);
+	slots[slot].quantityEntry = quantityView.emplace(item->getItemQuantity(), item);
+	slots[slot].nameEntry = nameView.emplace(item->getItemName(), item);
+	indexName(slot, item->getItemName());
+	refreshLowStock(slot, itemStorage.size() - 1);
+}
+
+// Drops the item from the ID index and views and retires its slot, the row itself is left to the caller
+void Inventory::unindexItem(Item* item, size_t row) {
+	logMutation(LogOperation::Remove, item);
+	itemIndex.erase(item->getItemID());
+	uint32_t slot = rowSlots[row];
+	priceView.erase(slots[slot].priceEntry);
+	quantityView.erase(slots[slot].quantityEntry);
+	nameView.erase(slots[slot].nameEntry);
+
+	CategoryBucket& bucket = buckets[static_cast<size_t>(categoryColumn[row])];
+	uint32_t position = slots[slot].bucketPosition;
+	uint32_t movedSlot = bucket.slots.back();
+	bucket.slots[position] = movedSlot; // Swap and pop within the bucket
+	slots[movedSlot].bucketPosition = position;
+	bucket.slots.pop_back();
+	bucket.stats.itemCount--;
+	bucket.stats.totalQuantity -= quantityColumn[row];
+	bucket.stats.totalValue -= priceColumn[row] * quantityColumn[row];
+
+	uint32_t lowStockPosition = slots[slot].lowStockPosition;
+	if (lowStockPosition != notLowStock) {
+		uint32_t movedLowSlot = lowStockSlots.back();
+		lowStockSlots[lowStockPosition] = movedLowSlot;
+		slots[movedLowSlot].lowStockPosition = lowStockPosition;
+		lowStockSlots.pop_back();
+	}
+
+	slots[slot].generation++; // Outstanding handles stop resolving
+	freeSlots.push_back(slot);
+	slots[slot].nameSerial = retiredNameSerial; // Its postings no longer match any slot
+	unindexName(item->getItemName());
+	idColumn.releaseRow(row);
+	nameColumn.releaseRow(row);
+}
+
+void Inventory::moveRow(size_t from, size_t to) {
+	itemStorage[to] = itemStorage[from];
+	quantityColumn[to] = quantityColumn[from];
+	priceColumn[to] = priceColumn[from];
+	categoryColumn[to] = categoryColumn[from];
+	idColumn.moveRow(from, to);
+	nameColumn.moveRow(from, to);
+	rowSlots[to] = rowSlots[from];
+	slots[rowSlots[to]].row = static_cast<uint32_t>(to);
+}
+
+void Inventory::truncateRows(size_t rowCount) {
+	itemStorage.resize(rowCount);
+	quantityColumn.resize(rowCount);
+	priceColumn.resize(rowCount);
+	categoryColumn.resize(rowCount);
+	idColumn.truncate(rowCount);
+	nameColumn.truncate(rowCount);
+	rowSlots.resize(rowCount);
+}
+
+// Removes the item from storage and every index in O(1) by moving the last row into its place, the caller frees it
+void Inventory::unstoreItem(Item* item) {
+	size_t row = findRow(item->getItemID());
+	size_t last = itemStorage.size() - 1;
+	unindexItem(item, row);
+	if (row != last) {
+		moveRow(last, row);
+	}
+	truncateRows(last);
+}
+
+// Room for that many more items before a bulk load, so the ID hash and the columns grow once
+void Inventory::reserveItems(size_t additional) {
+	size_t count = itemStorage.size() + additional;
+	itemStorage.reserve(count);
+	itemIndex.reserve(count);
+	slots.reserve(count);
+	rowSlots.reserve(count);
+	quantityColumn.reserve(count);
+	priceColumn.reserve(count);
+	categoryColumn.reserve(count);
+	idColumn.reserve(count);
+	nameColumn.reserve(count);
+}
+
+// Removes every marked row and compacts the columns once, keeping the order of the remaining rows
+size_t Inventory::removeRows(const vector<char>& removeRow) {
+	size_t kept = 0, removed = 0;
+	for (size_t row = 0; row < itemStorage.size(); row++) {
+		if (removeRow[row]) {
+			Item* item = itemStorage[row];
+			unindexItem(item, row);
+			destroyItem(item);
+			removed++;
+		} else {
+			if (kept != row) {
+				moveRow(row, kept);
+			}
+			kept++;
+		}
+	}
+	truncateRows(kept);
+	return removed;
+}
+
+// Caller holds the exclusive lock, the lowercased IDs that match no item are added to missing
+size_t Inventory::removeIds(const vector<string>& ids, vector<string>& missing) {
+	vector<char> removeRow(itemStorage.size(), 0);
+	string id;
+	for (const string& requested : ids) {
+		id = requested;
+		toLowerCase(id);
+		size_t row = findRow(id);
+		if (row != string::npos) {
+			removeRow[row] = 1;
+		} else {
+			missing.push_back(id);
+		}
+	}
+	return removeRows(removeRow);
+}
+
+size_t Inventory::removeItems(const vector<string>& ids) {
+	INVENTORY_METRIC(Remove);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	vector<string> missing;
+	return removeIds(ids, missing);
+}
+
+size_t Inventory::removeItems(const function<bool(const Item*)>& predicate) {
+	INVENTORY_METRIC(Remove);
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	vector<char> removeRow(itemStorage.size(), 0);
+	for (size_t row = 0; row < itemStorage.size(); row++) {
+		removeRow[row] = predicate(itemStorage[row]);
+	}
+	return removeRows(removeRow);
+}
+
+// Setters go through the inventory so the ordered views follow the new value
+void Inventory::setItemQuantity(Item* item, int newQuantity) {
+	size_t row = findRow(item->getItemID());
+	ItemSlot& slot = slots[rowSlots[row]];
+	quantityView.erase(slot.quantityEntry);
+	CategoryStats& stats = buckets[static_cast<size_t>(categoryColumn[row])].stats;
+	stats.totalQuantity += static_cast<long long>(newQuantity) - quantityColumn[row];
+	stats.totalValue += priceColumn[row] * (static_cast<long long>(newQuantity) - quantityColumn[row]);
+	item->setQuantity(newQuantity);
+	quantityColumn[row] = newQuantity;
+	liveQuantities[rowSlots[row]].quantity.store(newQuantity, memory_order_relaxed);
+	logMutation(LogOperation::SetQuantity, item);
+	slot.quantityEntry = quantityView.emplace(newQuantity, item);
+	refreshLowStock(rowSlots[row], row);
+}
+
+void Inventory::setItemPrice(Item* item, Money newPrice) {
+	size_t row = findRow(item->getItemID());
+	ItemSlot& slot = slots[rowSlots[row]];
+	priceView.erase(slot.priceEntry);
+	buckets[static_cast<size_t>(categoryColumn[row])].stats.totalValue += (newPrice - priceColumn[row]) * quantityColumn[row];
+	item->setPrice(newPrice);
+	priceColumn[row] = newPrice;
+	logMutation(LogOperation::SetPrice, item);
+	slot.priceEntry = priceView.emplace(newPrice, item);
+}
+
+// useCategoryReorderLevel makes the item follow its category again
+void Inventory::setItemReorderLevel(Item* item, int reorderLevel) {
+	size_t row = findRow(item->getItemID());
+	uint32_t slot = rowSlots[row];
+	slots[slot].reorderLevel = reorderLevel;
+	logReorderLevel(LogOperation::SetReorderLevel, categoryColumn[row], item->getItemID(), reorderLevel);
+	refreshLowStock(slot, row);
+}
+
+// Only the items of that category are rechecked
+void Inventory::setCategoryReorderLevel(CategoryTag tag, int reorderLevel) {
+	categoryReorderLevels[static_cast<size_t>(tag)] = reorderLevel;
+	logReorderLevel(LogOperation::SetCategoryReorderLevel, tag, "", reorderLevel);
+	for (uint32_t slot : buckets[static_cast<size_t>(tag)].slots) {
+		refreshLowStock(slot, slots[slot].row);
+	}
+}
+
+int Inventory::getReorderLevel(const Item* item) const {
+	return reorderLevelAt(findRow(item->getItemID()));
+}
+
+int Inventory::reorderLevelAt(size_t row) const {
+	int reorderLevel = slots[rowSlots[row]].reorderLevel;
+	return reorderLevel != useCategoryReorderLevel ? reorderLevel : getCategoryReorderLevel(categoryColumn[row]);
+}
+
+bool Inventory::lookupReorderLevel(const string& id, int& reorderLevel) const {
+	string key = id;
+	toLowerCase(key);
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	size_t row = findRow(key);
+	if (row == string::npos) {
+		return false;
+	}
+	reorderLevel = reorderLevelAt(row);
+	return true;
+}
+
+// Moves the item into or out of the low-stock set and reports the crossing
+void Inventory::refreshLowStock(uint32_t slot, size_t row) {
+	ItemSlot& itemSlot = slots[slot];
+	int reorderLevel = itemSlot.reorderLevel != useCategoryReorderLevel ? itemSlot.reorderLevel : getCategoryReorderLevel(categoryColumn[row]);
+	bool low = quantityColumn[row] <= reorderLevel;
+	bool listed = itemSlot.lowStockPosition != notLowStock;
+	if (low == listed) {
+		return;
+	}
+
+	if (low) {
+		itemSlot.lowStockPosition = static_cast<uint32_t>(lowStockSlots.size());
+		lowStockSlots.push_back(slot);
+	} else {
+		uint32_t movedSlot = lowStockSlots.back();
+		lowStockSlots[itemSlot.lowStockPosition] = movedSlot;
+		slots[movedSlot].lowStockPosition = itemSlot.lowStockPosition;
+		lowStockSlots.pop_back();
+		itemSlot.lowStockPosition = notLowStock;
+	}
+	if (lowStockCallback) {
+		lowStockCallback(itemStorage[row], reorderLevel, low);
+	}
+}
+
+// Rows of the low items in storage order
+vector<uint32_t> Inventory::lowStockRows() const {
+	vector<uint32_t> rows;
+	rows.reserve(lowStockSlots.size());
+	for (uint32_t slot : lowStockSlots) {
+		rows.push_back(slots[slot].row);
+	}
+	sort(rows.begin(), rows.end());
+	return rows;
+}
+
+vector<Item*> Inventory::lowStockItems() const {
+	INVENTORY_METRIC(LowStock);
+	vector<Item*> items;
+	for (uint32_t row : lowStockRows()) {
+		items.push_back(itemStorage[row]);
+	}
+	return items;
+}
+
+vector<ItemRecord> Inventory::lowStockRecords() const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return copyRecords(lowStockItems());
+}
+
+// Distinct trigrams of the lowercased name, each packed into one integer
+void Inventory::nameTrigrams(const string& name, vector<uint32_t>& trigrams) {
+	trigrams.clear();
+	for (size_t i = 0; i + 3 <= name.size(); i++) {
+		uint32_t trigram = 0;
+		for (size_t j = i; j < i + 3; j++) {
+			trigram = (trigram << 8) | static_cast<unsigned char>(tolower(static_cast<unsigned char>(name[j])));
+		}
+		trigrams.push_back(trigram);
+	}
+	sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void Inventory::indexName(uint32_t slot, const string& name) {
+	static thread_local vector<uint32_t> trigrams;
+	if (nextNameSerial == numeric_limits<uint32_t>::max()) {
+		rebuildNameIndex(); // Serials ran out, renumber the live items from zero
+	}
+	slots[slot].nameSerial = nextNameSerial++;
+	nameTrigrams(name, trigrams);
+	for (uint32_t trigram : trigrams) {
+		trigramIndex[trigram].postings.push_back({slots[slot].nameSerial, slot});
+	}
+}
+
+void Inventory::rebuildNameIndex() {
+	trigramIndex.clear();
+	nextNameSerial = 0;
+	for (size_t row = 0; row < itemStorage.size(); row++) {
+		indexName(rowSlots[row], itemStorage[row]->getItemName());
+	}
+}
+
+// Called once the item's slot is retired, so its postings already count as stale
+void Inventory::unindexName(const string& name) {
+	static thread_local vector<uint32_t> trigrams;
+	nameTrigrams(name, trigrams);
+	for (uint32_t trigram : trigrams) {
+		auto found = trigramIndex.find(trigram);
+		if (found == trigramIndex.end()) {
+			continue;
+		}
+		PostingList& list = found->second;
+		if (++list.stale * 2 < list.postings.size()) {
+			continue;
+		}
+		list.postings.erase(remove_if(list.postings.begin(), list.postings.end(), [this](const Posting& posting) {
+			return slots[posting.slot].nameSerial != posting.serial;
+		}), list.postings.end());
+		list.stale = 0;
+		if (list.postings.empty()) {
+			trigramIndex.erase(found);
+		}
+	}
+}
+
+// Names are stored capitalized word by word, so capitalizing the prefix the same way makes the name view case-insensitive
+vector<Item*> Inventory::namesWithPrefix(string_view prefix, size_t limit) const {
+	vector<Item*> result;
+	string key = capitalizeFirstLetter(string(prefix));
+	for (auto it = nameView.lower_bound(key); it != nameView.end() && result.size() < limit; ++it) {
+		if (it->first.compare(0, key.size(), key) != 0) {
+			break;
+		}
+		result.push_back(it->second);
+	}
+	return result;
+}
+
+vector<ItemRecord> Inventory::nameRecordsWithPrefix(string_view prefix, size_t limit) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return copyRecords(namesWithPrefix(prefix, limit));
+}
+
+vector<ItemRecord> Inventory::searchNameRecords(string_view text, size_t limit, size_t* matchCount) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return copyRecords(searchNames(text, limit, matchCount));
+}
+
+// Position of lowerText within the name ignoring case, or npos
+static size_t findIgnoringCase(string_view name, string_view lowerText) {
+	auto found = search(name.begin(), name.end(), lowerText.begin(), lowerText.end(), [](char a, char b) {
+		return tolower(static_cast<unsigned char>(a)) == b;
+	});
+	return found == name.end() && !lowerText.empty() ? string_view::npos : static_cast<size_t>(found - name.begin());
+}
+
+// Exact names first, then names starting with the text, then words starting with it, then any other match
+// Shorter names rank higher within each group
+void Inventory::rankNameMatches(vector<NameMatch>& matches, size_t limit) {
+	auto better = [](const NameMatch& a, const NameMatch& b) {
+		if (a.rank != b.rank) {
+			return a.rank < b.rank;
+		}
+		if (a.name.size() != b.name.size()) {
+			return a.name.size() < b.name.size();
+		}
+		int order = a.name.compare(b.name);
+		return order != 0 ? order < 0 : a.item->getItemID() < b.item->getItemID();
+	};
+	size_t kept = min(limit, matches.size());
+	partial_sort(matches.begin(), matches.begin() + kept, matches.end(), better);
+	matches.resize(kept);
+}
+
+// Text of three or more characters is looked up by intersecting the posting lists of its trigrams
+// Shorter text has no trigram and only matches name prefixes
+vector<Item*> Inventory::searchNames(string_view text, size_t limit, size_t* matchCount) const {
+	INVENTORY_METRIC(Search);
+	string lowerText(text);
+	toLowerCase(lowerText);
+	vector<NameMatch> matches;
+	auto addMatch = [&](Item* item, string_view name, size_t position) {
+		int rank = position == 0 ? (name.size() == lowerText.size() ? 0 : 1) : (isspace(static_cast<unsigned char>(name[position - 1])) ? 2 : 3);
+		matches.push_back({item, name, rank});
+	};
+
+	if (lowerText.size() < 3) {
+		for (Item* item : namesWithPrefix(lowerText, numeric_limits<size_t>::max())) {
+			addMatch(item, item->getItemName(), 0);
+		}
+	} else {
+		vector<uint32_t> trigrams;
+		vector<const PostingList*> lists;
+		nameTrigrams(lowerText, trigrams);
+		for (uint32_t trigram : trigrams) {
+			auto found = trigramIndex.find(trigram);
+			if (found == trigramIndex.end()) {
+				lists.clear(); // Some trigram occurs in no name
+				break;
+			}
+			lists.push_back(&found->second);
+		}
+		sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+			return a->postings.size() < b->postings.size();
+		});
+
+		// Start from the rarest trigram and keep the postings every other list also holds
+		vector<Posting> candidates;
+		if (!lists.empty()) {
+			candidates = lists[0]->postings;
+		}
+		for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+			const vector<Posting>& postings = lists[i]->postings;
+			size_t kept = 0, position = 0;
+			for (const Posting& candidate : candidates) {
+				// Gallop ahead, then binary search the last step
+				size_t step = 1;
+				while (position + step < postings.size() && postings[position + step].serial < candidate.serial) {
+					position += step;
+					step *= 2;
+				}
+				position = lower_bound(postings.begin() + position, postings.begin() + min(position + step, postings.size()), candidate,
+				                       [](const Posting& a, const Posting& b) { return a.serial < b.serial; }) - postings.begin();
+				if (position < postings.size() && postings[position].serial == candidate.serial) {
+					candidates[kept++] = candidate;
+				}
+			}
+			candidates.resize(kept);
+		}
+
+		// Stale postings are dropped here, and since the trigrams may occur apart each survivor is checked against the whole text
+		for (const Posting& candidate : candidates) {
+			if (slots[candidate.slot].nameSerial != candidate.serial) {
+				continue; // Removed since it was indexed
+			}
+			size_t row = slots[candidate.slot].row;
+			string_view name = nameColumn[row];
+			size_t position = findIgnoringCase(name, lowerText);
+			if (position != string_view::npos) {
+				addMatch(itemStorage[row], name, position);
+			}
+		}
+	}
+
+	if (matchCount != nullptr) {
+		*matchCount = matches.size();
+	}
+	rankNameMatches(matches, limit);
+	vector<Item*> result;
+	result.reserve(matches.size());
+	for (const NameMatch& match : matches) {
+		result.push_back(match.item);
+	}
+	return result;
+}
+
+// O(limit) walk of an ordered view in either direction
+template <typename Key>
+vector<Item*> Inventory::viewItems(const multimap<Key, Item*>& view, bool ascending, size_t limit) {
+	vector<Item*> result;
+	result.reserve(min(view.size(), limit));
+	if (ascending) {
+		for (auto it = view.begin(); it != view.end() && result.size() < limit; ++it) {
+			result.push_back(it->second);
+		}
+	} else {
+		// Key groups from the largest down, each group still in insertion order so ties keep the order of the ascending walk
+		for (auto groupEnd = view.end(); groupEnd != view.begin() && result.size() < limit;) {
+			auto groupBegin = prev(groupEnd);
+			while (groupBegin != view.begin() && !(prev(groupBegin)->first < groupBegin->first)) {
+				--groupBegin;
+			}
+			for (auto it = groupBegin; it != groupEnd && result.size() < limit; ++it) {
+				result.push_back(it->second);
+			}
+			groupEnd = groupBegin;
+		}
+	}
+	return result;
+}
+
+// O(log n + k) walk of the items whose key is within [min, max]
+template <typename Key>
+vector<Item*> Inventory::viewRange(const multimap<Key, Item*>& view, const Key& min, const Key& max) {
+	vector<Item*> result;
+	for (auto it = view.lower_bound(min); it != view.end() && !(max < it->first); ++it) {
+		result.push_back(it->second);
+	}
+	return result;
+}
+
+// Items of one category in bucket order, O(items in the category)
+vector<Item*> Inventory::itemsInCategory(CategoryTag tag) const {
+	INVENTORY_METRIC(CategoryListing);
+	const CategoryBucket& bucket = buckets[static_cast<size_t>(tag)];
+	vector<Item*> result;
+	result.reserve(bucket.slots.size());
+	for (uint32_t slot : bucket.slots) {
+		result.push_back(itemStorage[slots[slot].row]);
+	}
+	return result;
+}
+
+vector<ItemRecord> Inventory::recordsInCategory(CategoryTag tag) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return copyRecords(itemsInCategory(tag));
+}
+
+vector<Item*> Inventory::itemsInPriceRange(Money minPrice, Money maxPrice) const {
+	INVENTORY_METRIC(Range);
+	return viewRange(priceView, minPrice, maxPrice);
+}
+
+vector<Item*> Inventory::itemsInQuantityRange(int minQuantity, int maxQuantity) const {
+	INVENTORY_METRIC(Range);
+	return viewRange(quantityView, minQuantity, maxQuantity);
+}
+
+bool Inventory::validateChar(char input) {
+	return isalpha(input);
+}
+
+bool Inventory::isString(const string& input) {
+	for (char c : input) {
+		if (!isalpha(c) && !isdigit(c) && c != ' ') {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Inventory::validateString(const string &input) {
+	return !input.empty();
+}
+
+string Inventory::capitalizeFirstLetter(const string& input) {
+	string result;
+	bool capitalizeNext = true;
+
+	for (char c : input) {
+		if (isspace(c)) {
+			capitalizeNext = true; 
+			result += c; // Add space as it is
+		} else {
+			if (capitalizeNext) {
+				result += toupper(c); // Capitalize the character
+				capitalizeNext = false; // Reset flag
+			} else {
+				result += tolower(c); // Lowercase the character
+			}
+		}
+	}
+	return result;
+}
+
+bool Inventory::validateInt(int input) {
+	return input >= 0;
+}
+
+bool Inventory::isAllDigits(string_view input) {
+	for (unsigned char c : input) {
+		if (!isdigit(c) || isspace(c)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void toLowerCase(string& str) {
+	for (char&  c : str) {
+		if (c >= 'A' && c <= 'Z') {
+			c += 32;
+		}
+	}
+}
+
+bool Inventory::parseSortField(char letter, SortField* field) {
+	SortField parsed;
+	switch (letter) {
+		case 'Q': parsed = SortField::Quantity; break;
+		case 'P': parsed = SortField::Price; break;
+		case 'N': parsed = SortField::Name; break;
+		case 'I': parsed = SortField::ID; break;
+		case 'C': parsed = SortField::Category; break;
+		case 'V': parsed = SortField::Value; break;
+		default: return false;
+	}
+	if (field != nullptr) {
+		*field = parsed;
+	}
+	return true;
+}
+
+// Compares two items by every key in turn, returns true if a goes before b
+bool Inventory::compareItems(const Item* a, const Item* b, const vector<SortKey>& keys) {
+	return compareItemKeys(a, b, keys) < 0; // Equal on every key, stable sort keeps the current order
+}
+
+int Inventory::compareItemKeys(const Item* a, const Item* b, const vector<SortKey>& keys) {
+	for (const SortKey& key : keys) {
+		int result = 0;
+		switch (key.field) {
+			case SortField::Quantity:
+				result = (a->getItemQuantity() > b->getItemQuantity()) - (a->getItemQuantity() < b->getItemQuantity());
+				break;
+			case SortField::Price:
+				result = (a->getItemPrice() > b->getItemPrice()) - (a->getItemPrice() < b->getItemPrice());
+				break;
+			case SortField::Name:
+				result = a->getItemName().compare(b->getItemName());
+				break;
+			case SortField::ID:
+				result = a->getItemID().compare(b->getItemID());
+				break;
+			case SortField::Category:
+				result = categoryNameRank[a->getCategoryTag()] - categoryNameRank[b->getCategoryTag()];
+				break;
+			case SortField::Value: {
+				Money first = a->getItemPrice() * a->getItemQuantity(), second = b->getItemPrice() * b->getItemQuantity();
+				result = (first > second) - (first < second);
+				break;
+			}
+		}
+		if (result != 0) {
+			return key.ascending ? result : -result;
+		}
+	}
+	return 0;
+}
+
+// A single quantity, price or name key is a walk of its ordered view, itemStorage keeps its order
+// Otherwise the first limit items are picked with bounded heaps, or the whole inventory gets a stable O(n log n) sort of a copy of
+// itemStorage, large inventories are sorted in chunks on several threads and merged
+vector<ItemRecord> Inventory::sortedRecords(const vector<SortKey>& keys, size_t limit) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	return copyRecords(sortedItems(keys, limit));
+}
+
+vector<Item*> Inventory::sortedItems(const vector<SortKey>& keys, size_t limit) const {
+	INVENTORY_METRIC(Sort);
+	if (keys.size() == 1 && keys.front().field == SortField::Quantity) {
+		return viewItems(quantityView, keys.front().ascending, limit);
+	} else if (keys.size() == 1 && keys.front().field == SortField::Price) {
+		return viewItems(priceView, keys.front().ascending, limit);
+	} else if (keys.size() == 1 && keys.front().field == SortField::Name) {
+		return viewItems(nameView, keys.front().ascending, limit);
+	}
+
+	if (limit < itemStorage.size()) {
+		ItemQuery everything;
+		everything.limit = limit;
+		size_t examined = 0;
+		vector<Item*> top;
+		for (uint32_t row : topRows(everything, keys, examined)) {
+			top.push_back(itemStorage[row]);
+		}
+		return top;
+	}
+
+	vector<Item*> sorted = itemStorage;
+	auto compare = [&keys](const Item* a, const Item* b) {
+		return compareItems(a, b, keys);
+	};
+
+	size_t threadCount = thread::hardware_concurrency();
+	if (sorted.size() < parallelSortThreshold || threadCount < 2) {
+		stable_sort(sorted.begin(), sorted.end(), compare);
+		return sorted;
+	}
+
+	// Sort each chunk on its own thread
+	size_t chunkSize = (sorted.size() + threadCount - 1) / threadCount;
+	vector<size_t> bounds;
+	for (size_t start = 0; start < sorted.size(); start += chunkSize) {
+		bounds.push_back(start);
+	}
+	bounds.push_back(sorted.size());
+
+	vector<thread> workers;
+	for (size_t i = 0; i + 1 < bounds.size(); i++) {
+		workers.emplace_back([&sorted, &bounds, &compare, i]() {
+			stable_sort(sorted.begin() + bounds[i], sorted.begin() + bounds[i + 1], compare);
+		});
+	}
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	// Merge neighbouring chunks until one sorted range is left, left chunks win ties to stay stable
+	while (bounds.size() > 2) {
+		vector<size_t> merged;
+		for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+			merged.push_back(bounds[i]);
+			if (i + 2 < bounds.size()) {
+				inplace_merge(sorted.begin() + bounds[i], sorted.begin() + bounds[i + 1],
+				              sorted.begin() + bounds[i + 2], compare);
+			}
+		}
+		merged.push_back(bounds.back());
+		bounds.swap(merged);
+	}
+	return sorted;
+}
+
+// Splits a query into words, quoted text, operators and commas, a quoted token keeps its quotes
+static bool splitQuery(string_view text, vector<string_view>& tokens, string& error) {
+	tokens.clear();
+	size_t position = 0;
+	while (position < text.size()) {
+		char c = text[position];
+		size_t end = position + 1;
+		if (isspace(static_cast<unsigned char>(c))) {
+			position++;
+			continue;
+		} else if (c == '"') {
+			end = text.find('"', position + 1);
+			if (end == string_view::npos) {
+				error = "unterminated quote";
+				return false;
+			}
+			end++;
+		} else if (c == '<' || c == '>' || c == '!' || c == '=') {
+			if (end < text.size() && (text[end] == '=' || (c == '<' && text[end] == '>'))) {
+				end++;
+			}
+		} else if (c != ',') {
+			while (end < text.size() && (isalnum(static_cast<unsigned char>(text[end])) || text[end] == '.' || text[end] == '_')) {
+				end++;
+			}
+			if (!isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '_') {
+				error = string("unexpected character '") + c + "'";
+				return false;
+			}
+		}
+		tokens.push_back(text.substr(position, end - position));
+		position = end;
+	}
+	return true;
+}
+
+static bool isKeyword(string_view token, string_view keyword) {
+	if (token.size() != keyword.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < token.size(); i++) {
+		if (tolower(static_cast<unsigned char>(token[i])) != keyword[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool parseQueryField(string_view token, SortField& field) {
+	static const pair<const char*, SortField> fields[] = {
+		{"id", SortField::ID}, {"name", SortField::Name}, {"category", SortField::Category},
+		{"quantity", SortField::Quantity}, {"price", SortField::Price}, {"value", SortField::Value}
+	};
+	for (const auto& entry : fields) {
+		if (isKeyword(token, entry.first)) {
+			field = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+// One value of a condition, quantities and prices as integers and text lowercased
+static bool parseQueryValue(SortField field, string_view token, QueryCondition& condition, long long& value, string& error) {
+	if (token.size() >= 2 && token.front() == '"') {
+		token = token.substr(1, token.size() - 2);
+	}
+	if (token.empty()) {
+		error = "missing value";
+		return false;
+	}
+	switch (field) {
+		case SortField::Quantity:
+			if (!parseNumber(token, value)) {
+				error = "quantity needs a whole number, not '" + string(token) + "'";
+				return false;
+			}
+			return true;
+		case SortField::Price:
+		case SortField::Value: {
+			Money price;
+			if (!Money::parse(token, price)) {
+				error = (field == SortField::Price ? "price" : "value") + string(" needs an amount with at most two decimals, not '") + string(token) + "'";
+				return false;
+			}
+			value = price.getCents();
+			return true;
+		}
+		case SortField::Category: {
+			CategoryTag tag;
+			if (Inventory::parseCategoryCode(token, tag)) {
+				value = static_cast<long long>(tag);
+				return true;
+			}
+			for (const CategoryInfo& info : categoryTable) {
+				if (token.size() == strlen(info.name) && equal(token.begin(), token.end(), info.name, [](char a, char b) {
+					return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+				})) {
+					value = static_cast<long long>(info.tag);
+					return true;
+				}
+			}
+			error = "unknown category '" + string(token) + "'";
+			return false;
+		}
+		default:
+			condition.text = string(token);
+			toLowerCase(condition.text);
+			return true;
+	}
+}
+
+// [conditions joined by AND] [ORDER BY field [ASC|DESC], ...] [LIMIT n], keywords and fields in any case
+bool Inventory::parseQuery(string_view text, ItemQuery& query, string& error) {
+	query = ItemQuery();
+	vector<string_view> tokens;
+	if (!splitQuery(text, tokens, error)) {
+		return false;
+	}
+	size_t position = 0;
+	auto next = [&]() {
+		return position < tokens.size() ? tokens[position++] : string_view();
+	};
+	auto peek = [&]() {
+		return position < tokens.size() ? tokens[position] : string_view();
+	};
+
+	while (position < tokens.size() && !isKeyword(peek(), "order") && !isKeyword(peek(), "limit")) {
+		if (!query.conditions.empty() && !isKeyword(next(), "and")) {
+			error = "conditions must be joined by AND";
+			return false;
+		}
+		QueryCondition condition;
+		string_view fieldName = next(), operation = next();
+		if (!parseQueryField(fieldName, condition.field)) {
+			error = "unknown field '" + string(fieldName) + "', use id, name, category, quantity, price or value";
+			return false;
+		}
+		bool numeric = condition.field == SortField::Quantity || condition.field == SortField::Price || condition.field == SortField::Value;
+		long long value = 0, upper = 0;
+		if (isKeyword(operation, "between")) {
+			if (!numeric) {
+				error = "BETWEEN only applies to quantity, price and value";
+				return false;
+			}
+			if (!parseQueryValue(condition.field, next(), condition, value, error)) {
+				return false;
+			}
+			if (!isKeyword(next(), "and")) {
+				error = "BETWEEN needs AND between its bounds";
+				return false;
+			}
+			if (!parseQueryValue(condition.field, next(), condition, upper, error)) {
+				return false;
+			}
+			condition.low = value;
+			condition.high = upper;
+		} else {
+			bool equality = operation == "=" || operation == "==" || operation == "!=" || operation == "<>";
+			bool ordering = operation == "<" || operation == "<=" || operation == ">" || operation == ">=";
+			if (!equality && !ordering) {
+				error = "expected a comparison after " + string(fieldName);
+				return false;
+			}
+			if (ordering && !numeric) {
+				error = "only = and != apply to " + string(fieldName);
+				return false;
+			}
+			if (!parseQueryValue(condition.field, next(), condition, value, error)) {
+				return false;
+			}
+			const long long lowest = numeric_limits<long long>::min(), highest = numeric_limits<long long>::max();
+			if (operation == "<") {
+				condition.high = value - 1; // Values are never negative, so this cannot wrap
+			} else if (operation == "<=") {
+				condition.high = value;
+			} else if (operation == ">") {
+				condition.low = value == highest ? highest : value + 1;
+				condition.high = value == highest ? lowest : highest; // Nothing is above the largest value
+			} else if (operation == ">=") {
+				condition.low = value;
+			} else {
+				condition.low = condition.high = value;
+				condition.negated = operation == "!=" || operation == "<>";
+			}
+		}
+		query.conditions.push_back(move(condition));
+	}
+
+	if (isKeyword(peek(), "order")) {
+		next();
+		if (!isKeyword(next(), "by")) {
+			error = "ORDER needs BY";
+			return false;
+		}
+		do {
+			SortKey key = {SortField::ID, true};
+			string_view fieldName = next();
+			if (!parseQueryField(fieldName, key.field)) {
+				error = "cannot order by '" + string(fieldName) + "'";
+				return false;
+			}
+			if (isKeyword(peek(), "asc") || isKeyword(peek(), "desc")) {
+				key.ascending = isKeyword(next(), "asc");
+			}
+			query.order.push_back(key);
+		} while (peek() == "," && !next().empty());
+	}
+
+	if (isKeyword(peek(), "limit")) {
+		next();
+		string_view count = next();
+		if (!parseNumber(count, query.limit)) {
+			error = "LIMIT needs a whole number";
+			return false;
+		}
+	}
+
+	if (position < tokens.size()) {
+		error = "unexpected '" + string(tokens[position]) + "'";
+		return false;
+	}
+	return true;
+}
+
+static bool equalsLowercase(string_view text, const string& lowercase) {
+	if (text.size() != lowercase.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < text.size(); i++) {
+		if (tolower(static_cast<unsigned char>(text[i])) != lowercase[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Range check without branches, the range must not be empty
+static inline bool inRange(long long value, long long low, long long high) {
+	return static_cast<unsigned long long>(value) - static_cast<unsigned long long>(low) <=
+	       static_cast<unsigned long long>(high) - static_cast<unsigned long long>(low);
+}
+
+static bool conditionHolds(const QueryCondition& condition, string_view id, string_view name, int quantity, Money price, CategoryTag tag) {
+	bool holds;
+	switch (condition.field) {
+		case SortField::ID: holds = equalsLowercase(id, condition.text); break;
+		case SortField::Name: holds = equalsLowercase(name, condition.text); break;
+		case SortField::Quantity: holds = condition.low <= quantity && quantity <= condition.high; break;
+		case SortField::Price: holds = condition.low <= price.getCents() && price.getCents() <= condition.high; break;
+		case SortField::Value: holds = condition.low <= (price * quantity).getCents() && (price * quantity).getCents() <= condition.high; break;
+		default: holds = condition.low <= static_cast<long long>(tag) && static_cast<long long>(tag) <= condition.high; break;
+	}
+	return holds != condition.negated;
+}
+
+bool Inventory::itemMatches(const Item* item, const vector<QueryCondition>& conditions) const {
+	for (const QueryCondition& condition : conditions) {
+		if (!conditionHolds(condition, item->getItemID(), item->getItemName(), item->getItemQuantity(), item->getItemPrice(), getCategoryTag(item))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static long long keyValue(Money key) {
+	return key.getCents();
+}
+static long long keyValue(int key) {
+	return key;
+}
+
+// Like viewRange, but gives up once the range holds more than budget items
+// Ranges that look wider than the budget from the first and last keys are not walked at all
+template <typename Key>
+bool Inventory::boundedViewRange(const multimap<Key, Item*>& view, const Key& min, const Key& max, size_t budget, vector<Item*>& result) {
+	result.clear();
+	if (view.empty()) {
+		return true;
+	}
+	double first = static_cast<double>(keyValue(view.begin()->first)), last = static_cast<double>(keyValue(view.rbegin()->first));
+	double low = std::max<double>(first, keyValue(min)), high = std::min<double>(last, keyValue(max));
+	if (last > first && high >= low && (high - low) / (last - first) * view.size() > budget) {
+		return false;
+	}
+	for (auto it = view.lower_bound(min); it != view.end() && !(max < it->first); ++it) {
+		if (result.size() == budget) {
+			return false;
+		}
+		result.push_back(it->second);
+	}
+	return true;
+}
+
+// Walks a view in the order of the first ORDER BY key until LIMIT items match, plus the items tying with the last
+// Gives up after budget items, so a condition that rejects most items falls back to a scan
+template <typename Key>
+bool Inventory::orderedViewWalk(const multimap<Key, Item*>& view, bool ascending, const ItemQuery& query, size_t budget, QueryResult& result) const {
+	result.items.clear();
+	result.examined = 0;
+	if (query.limit == 0) {
+		return true;
+	}
+	const Key* lastKey = nullptr;
+	bool complete = false; // Every item up to the last tie was visited
+	auto visit = [&](const pair<const Key, Item*>& entry) {
+		if (result.items.size() >= query.limit && !(entry.first == *lastKey)) {
+			complete = true;
+			return false;
+		}
+		result.examined++;
+		if (itemMatches(entry.second, query.conditions)) {
+			result.items.push_back(entry.second);
+			lastKey = &entry.first;
+		}
+		return true;
+	};
+	if (ascending) {
+		auto it = view.begin();
+		for (; it != view.end() && result.examined < budget && visit(*it); ++it) {}
+		complete = complete || it == view.end();
+	} else {
+		auto it = view.rbegin();
+		for (; it != view.rend() && result.examined < budget && visit(*it); ++it) {}
+		complete = complete || it == view.rend();
+	}
+	return complete;
+}
+
+// Filters the columns a block at a time, every condition narrows the block's selection of rows in one tight loop
+// Quantity, price, value and category tests compile to branch-free compare and store, and never touch the items
+// Matches go to the vector in row order, or to the heap when only the first few in some order are wanted
+void Inventory::scanRows(const ItemQuery& query, size_t begin, size_t end, bool stopAtLimit, vector<Item*>* matches, TopRows* top, size_t& examined) const {
+	const size_t blockRows = 4096;
+	uint32_t selection[blockRows];
+
+	// Numbers first, they are cheaper to test than text
+	vector<const QueryCondition*> conditions;
+	for (const QueryCondition& condition : query.conditions) {
+		if (condition.field != SortField::ID && condition.field != SortField::Name) {
+			if (condition.low > condition.high && !condition.negated) {
+				return; // Nothing can match
+			}
+			if (condition.low <= condition.high) {
+				conditions.push_back(&condition);
+			}
+		}
+	}
+	for (const QueryCondition& condition : query.conditions) {
+		if (condition.field == SortField::ID || condition.field == SortField::Name) {
+			conditions.push_back(&condition);
+		}
+	}
+
+	for (size_t start = begin; start < end && !(stopAtLimit && matches->size() >= query.limit); start += blockRows) {
+		size_t count = min(blockRows, end - start);
+		for (size_t i = 0; i < count; i++) {
+			selection[i] = static_cast<uint32_t>(start + i);
+		}
+		examined += count;
+
+		for (const QueryCondition* condition : conditions) {
+			size_t kept = 0;
+			long long low = condition->low, high = condition->high;
+			bool negated = condition->negated;
+			switch (condition->field) {
+				case SortField::Quantity:
+					for (size_t i = 0; i < count; i++) {
+						selection[kept] = selection[i];
+						kept += inRange(quantityColumn[selection[i]], low, high) != negated;
+					}
+					break;
+				case SortField::Price:
+					for (size_t i = 0; i < count; i++) {
+						selection[kept] = selection[i];
+						kept += inRange(priceColumn[selection[i]].getCents(), low, high) != negated;
+					}
+					break;
+				case SortField::Value:
+					for (size_t i = 0; i < count; i++) {
+						selection[kept] = selection[i];
+						kept += inRange((priceColumn[selection[i]] * quantityColumn[selection[i]]).getCents(), low, high) != negated;
+					}
+					break;
+				case SortField::Category:
+					for (size_t i = 0; i < count; i++) {
+						selection[kept] = selection[i];
+						kept += inRange(static_cast<long long>(categoryColumn[selection[i]]), low, high) != negated;
+					}
+					break;
+				default: {
+					const StringColumn& column = condition->field == SortField::ID ? idColumn : nameColumn;
+					for (size_t i = 0; i < count; i++) {
+						selection[kept] = selection[i];
+						kept += equalsLowercase(column[selection[i]], condition->text) != negated;
+					}
+					break;
+				}
+			}
+			count = kept;
+		}
+
+		if (top != nullptr) {
+			for (size_t i = 0; i < count; i++) {
+				top->offer(selection[i]);
+			}
+		} else {
+			for (size_t i = 0; i < count; i++) {
+				matches->push_back(itemStorage[selection[i]]);
+			}
+		}
+	}
+}
+
+// Rows of the first query.limit matches in the order of the keys
+// Large inventories are split into ranges of rows, each thread keeps its own heap and the heaps are merged at the end
+vector<uint32_t> Inventory::topRows(const ItemQuery& query, const vector<SortKey>& keys, size_t& examined) const {
+	size_t rowCount = itemStorage.size();
+	size_t threadCount = rowCount < parallelSortThreshold ? 1 : max<size_t>(1, thread::hardware_concurrency());
+	size_t chunkSize = (rowCount + threadCount - 1) / threadCount;
+	vector<TopRows> heaps;
+	vector<size_t> counts(threadCount, 0);
+	for (size_t i = 0; i < threadCount; i++) {
+		heaps.emplace_back(itemStorage.data(), quantityColumn.data(), priceColumn.data(), keys, query.limit);
+	}
+
+	vector<thread> workers;
+	for (size_t i = 1; i < threadCount; i++) {
+		size_t start = min(rowCount, i * chunkSize), end = min(rowCount, start + chunkSize);
+		workers.emplace_back([&, i, start, end]() {
+			scanRows(query, start, end, false, nullptr, &heaps[i], counts[i]);
+		});
+	}
+	scanRows(query, 0, min(rowCount, chunkSize), false, nullptr, &heaps[0], counts[0]);
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	for (size_t i = 0; i < threadCount; i++) {
+		examined += counts[i];
+		if (i > 0) {
+			heaps[0].merge(heaps[i]);
+		}
+	}
+	return heaps[0].rows();
+}
+
+// Returns true when the items are already in the order, as the heaps leave them
+bool Inventory::scanQuery(const ItemQuery& query, const vector<SortKey>& order, QueryResult& result) const {
+	if (!order.empty() && query.limit < itemStorage.size()) {
+		for (uint32_t row : topRows(query, order, result.examined)) {
+			result.items.push_back(itemStorage[row]);
+		}
+		return true;
+	}
+	scanRows(query, 0, itemStorage.size(), order.empty(), &result.items, nullptr, result.examined);
+	return false;
+}
+
+QueryResult Inventory::runQuery(const ItemQuery& query) const {
+	INVENTORY_METRIC(Query);
+	QueryResult result;
+	vector<SortKey> order = query.order;
+	if (!order.empty()) {
+		order.push_back({SortField::ID, true}); // IDs are unique, so the order is total
+	}
+
+	// Tightest price and quantity ranges, and any exact ID or category
+	const long long lowest = numeric_limits<long long>::min(), highest = numeric_limits<long long>::max();
+	long long priceLow = lowest, priceHigh = highest, quantityLow = lowest, quantityHigh = highest;
+	const QueryCondition* idCondition = nullptr;
+	const QueryCondition* categoryCondition = nullptr;
+	for (const QueryCondition& condition : query.conditions) {
+		if (condition.negated) {
+			continue;
+		}
+		switch (condition.field) {
+			case SortField::ID: idCondition = &condition; break;
+			case SortField::Category: categoryCondition = condition.low == condition.high ? &condition : categoryCondition; break;
+			case SortField::Price: priceLow = max(priceLow, condition.low); priceHigh = min(priceHigh, condition.high); break;
+			case SortField::Quantity: quantityLow = max(quantityLow, condition.low); quantityHigh = min(quantityHigh, condition.high); break;
+			default: break;
+		}
+	}
+
+	// An index wins when it yields fewer candidates than the rows a scan could test for the same cost
+	size_t budget = itemStorage.size() / indexCandidateCost;
+	bool planned = false, ordered = false;
+	vector<Item*> candidates;
+	if (query.useIndexes && idCondition != nullptr) {
+		Item* item = findItem(idCondition->text);
+		if (item != nullptr) {
+			candidates.push_back(item);
+		}
+		result.access = QueryAccess::IDLookup;
+		planned = true;
+	} else if (query.useIndexes) {
+		if (categoryCondition != nullptr && buckets[categoryCondition->low].slots.size() <= budget) {
+			budget = buckets[categoryCondition->low].slots.size();
+			result.access = QueryAccess::CategoryBucket;
+			planned = true;
+		}
+		vector<Item*> range;
+		if ((priceLow != lowest || priceHigh != highest) && priceLow <= priceHigh &&
+		    boundedViewRange(priceView, Money::fromCents(priceLow), Money::fromCents(priceHigh), budget, range)) {
+			budget = range.size();
+			candidates.swap(range);
+			result.access = QueryAccess::PriceRange;
+			planned = true;
+		}
+		if ((quantityLow != lowest || quantityHigh != highest) && quantityLow <= quantityHigh &&
+		    boundedViewRange(quantityView, static_cast<int>(max<long long>(quantityLow, numeric_limits<int>::min())),
+		                     static_cast<int>(min<long long>(quantityHigh, numeric_limits<int>::max())), budget, range)) {
+			candidates.swap(range);
+			result.access = QueryAccess::QuantityRange;
+			planned = true;
+		}
+		if (result.access == QueryAccess::CategoryBucket) {
+			for (uint32_t slot : buckets[categoryCondition->low].slots) {
+				candidates.push_back(itemStorage[slots[slot].row]);
+			}
+		}
+	}
+
+	if (planned) {
+		result.examined = candidates.size();
+		for (Item* item : candidates) {
+			if (itemMatches(item, query.conditions)) {
+				result.items.push_back(item);
+			}
+		}
+	} else {
+		// A LIMIT on a query ordered by a viewed field can stop early along the view
+		bool walked = false;
+		if (query.useIndexes && !query.order.empty() && query.limit < itemStorage.size()) {
+			const SortKey& key = query.order.front();
+			if (key.field == SortField::Price) {
+				walked = orderedViewWalk(priceView, key.ascending, query, budget, result);
+				result.access = QueryAccess::PriceOrder;
+			} else if (key.field == SortField::Quantity) {
+				walked = orderedViewWalk(quantityView, key.ascending, query, budget, result);
+				result.access = QueryAccess::QuantityOrder;
+			} else if (key.field == SortField::Name) {
+				walked = orderedViewWalk(nameView, key.ascending, query, budget, result);
+				result.access = QueryAccess::NameOrder;
+			}
+		}
+		if (!walked) {
+			size_t walkedItems = result.examined;
+			result = QueryResult();
+			result.examined = walkedItems;
+			ordered = scanQuery(query, order, result);
+		}
+	}
+
+	auto compare = [&order](const Item* a, const Item* b) {
+		return compareItems(a, b, order);
+	};
+	if (!order.empty() && !ordered && query.limit < result.items.size()) {
+		partial_sort(result.items.begin(), result.items.begin() + query.limit, result.items.end(), compare);
+	} else if (!order.empty() && !ordered) {
+		sort(result.items.begin(), result.items.end(), compare);
+	}
+	if (result.items.size() > query.limit) {
+		result.items.resize(query.limit);
+	}
+	return result;
+}
+
+RecordQueryResult Inventory::queryRecords(const ItemQuery& query) const {
+	shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+	QueryResult result = runQuery(query);
+	RecordQueryResult records;
+	records.items = copyRecords(result.items);
+	records.access = result.access;
+	records.examined = result.examined;
+	return records;
+}
+
+const char* Inventory::getQueryAccessName(QueryAccess access) {
+	switch (access) {
+		case QueryAccess::IDLookup: return "id lookup";
+		case QueryAccess::CategoryBucket: return "category bucket";
+		case QueryAccess::PriceRange: return "price range";
+		case QueryAccess::QuantityRange: return "quantity range";
+		case QueryAccess::PriceOrder: return "price order";
+		case QueryAccess::QuantityOrder: return "quantity order";
+		case QueryAccess::NameOrder: return "name order";
+		default: return "column scan";
+	}
+}
+
+TopRows::TopRows(Item* const* rowItems, const int* quantityColumn, const Money* priceColumn, const vector<SortKey>& keys, size_t count)
+	: items(rowItems), quantities(quantityColumn), prices(priceColumn), firstKey{SortField::ID, true}, limit(count) {
+	if (!keys.empty()) {
+		firstKey = keys.front();
+	}
+	numericFirst = !keys.empty() && (firstKey.field == SortField::Quantity || firstKey.field == SortField::Price || firstKey.field == SortField::Value);
+	tieKeys.assign(keys.begin() + (numericFirst ? 1 : 0), keys.end());
+	heap.reserve(min<size_t>(limit, 1 << 16));
+}
+
+long long TopRows::keyOf(uint32_t row) const {
+	switch (numericFirst ? firstKey.field : SortField::ID) {
+		case SortField::Quantity: return quantities[row];
+		case SortField::Price: return prices[row].getCents();
+		case SortField::Value: return (prices[row] * quantities[row]).getCents();
+		default: return 0;
+	}
+}
+
+bool TopRows::before(const Entry& a, const Entry& b) const {
+	if (a.key != b.key) {
+		return firstKey.ascending ? a.key < b.key : a.key > b.key;
+	}
+	int result = tieKeys.empty() ? 0 : Inventory::compareItemKeys(items[a.row], items[b.row], tieKeys);
+	return result != 0 ? result < 0 : a.row < b.row;
+}
+
+void TopRows::offer(const Entry& entry) {
+	auto later = [this](const Entry& a, const Entry& b) {
+		return before(a, b);
+	};
+	if (heap.size() < limit) {
+		heap.push_back(entry);
+		push_heap(heap.begin(), heap.end(), later);
+	} else if (limit > 0 && before(entry, heap.front())) {
+		pop_heap(heap.begin(), heap.end(), later);
+		heap.back() = entry;
+		push_heap(heap.begin(), heap.end(), later);
+	}
+}
+
+void TopRows::merge(const TopRows& other) {
+	for (const Entry& entry : other.heap) {
+		offer(entry);
+	}
+}
+
+vector<uint32_t> TopRows::rows() const {
+	vector<Entry> sorted = heap;
+	sort_heap(sorted.begin(), sorted.end(), [this](const Entry& a, const Entry& b) {
+		return before(a, b);
+	});
+	vector<uint32_t> result;
+	result.reserve(sorted.size());
+	for (const Entry& entry : sorted) {
+		result.push_back(entry.row);
+	}
+	return result;
+}
+
+string Inventory::getCategory(const Item* item) {
+	return getCategoryName(item->getCategoryTag());
+}
+
+CategoryTag Inventory::getCategoryTag(const Item* item) {
+	return item->getCategoryTag();
+}
+
+// Accepts the category code in any case
+bool Inventory::parseCategoryCode(string_view code, CategoryTag& tag) {
+	for (const CategoryInfo& info : categoryTable) {
+		string_view infoCode = info.code;
+		if (code.size() != infoCode.size()) {
+			continue;
+		}
+		bool matches = true;
+		for (size_t i = 0; i < code.size() && matches; i++) {
+			matches = tolower(static_cast<unsigned char>(code[i])) == infoCode[i];
+		}
+		if (matches) {
+			tag = info.tag;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* Inventory::getCategoryName(CategoryTag tag) {
+	return categoryTable[static_cast<size_t>(tag)].name;
+}
+
+const char* Inventory::getCategoryCode(CategoryTag tag) {
+	return categoryTable[static_cast<size_t>(tag)].code;
+}
+
+// Price rule for error messages
+static string priceRequirement() {
+	return "a positive amount up to " + Money::fromCents(Money::maxPriceCents).toString() + " with at most two decimals";
+}
+
+// Codes for error messages, e.g. "cl, el or en"
+static string categoryCodeChoices() {
+	string choices;
+	for (size_t i = 0; i < categoryCount; i++) {
+		if (i > 0) {
+			choices += i + 1 == categoryCount ? " or " : ", ";
+		}
+		choices += categoryTable[i].code;
+	}
+	return choices;
+}
+
+// Factory for the registry class that matches the tag
+Item* Inventory::createItem(CategoryTag tag, const string& id, const string& name, int quantity, Money price) {
+	return itemPools.create(tag, id, name, quantity, price);
+}
+
+// Returns the item's slot to its pool, the item must already be unstored
+void Inventory::destroyItem(Item* item) {
+	itemPools.destroy(item);
+}
+
+void Inventory::clear() {
+	for(Item* item : itemStorage) {
+		item->~Item(); // Release the strings each item owns
+	}
+	// Then free the slabs in bulk instead of one item at a time
+	itemPools.releaseAll();
+	itemStorage.clear();
+	itemIndex.clear();
+	slots.clear();
+	freeSlots.clear();
+	rowSlots.clear();
+	for (CategoryBucket& bucket : buckets) {
+		bucket = CategoryBucket();
+	}
+	lowStockSlots.clear();
+	quantityColumn.clear();
+	priceColumn.clear();
+	categoryColumn.clear();
+	idColumn.clear();
+	nameColumn.clear();
+	priceView.clear();
+	quantityView.clear();
+	nameView.clear();
+	trigramIndex.clear();
+	nextNameSerial = 0;
+	liveQuantities.clear();
+	pendingAdjustments = noPendingSlot;
+}
+
+// Snapshot layout: header, fixed-width record table, reorder levels, then a string pool holding every ID and name
+// Version 2 added the reorder levels, one int32 per record followed by one per category
+// Version 3 stores prices in cents instead of as doubles, version 1 and 2 files still load
+// Version 4 writes the category count before the category levels, so files stay loadable when the registry grows
+const char snapshotMagic[4] = {'I', 'N', 'V', 'S'};
+const uint32_t snapshotVersion = 4;
+const size_t legacyCategoryCount = 3; // Categories of every file before version 4
+
+struct SnapshotHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t itemCount;
+	uint64_t stringPoolSize;
+	uint64_t checksum; // FNV-1a over the record table and the string pool
+};
+
+struct SnapshotRecord {
+	int64_t price; // Cents, a double before version 3
+	uint32_t idOffset;
+	uint32_t idLength;
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	int32_t quantity;
+	uint8_t category;
+	uint8_t padding[3];
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "Snapshot header must stay 32 bytes");
+static_assert(sizeof(SnapshotRecord) == 32, "Snapshot records must stay 32 bytes");
+
+uint64_t fnv1a(const void* data, size_t length, uint64_t hash = 14695981039346656037ULL) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Makes a rename into the directory of the path durable, Windows offers no directory sync
+bool syncDirectory(const string& path) {
+#ifdef _WIN32
+	(void)path;
+	return true;
+#else
+	size_t slash = path.find_last_of('/');
+	string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	int fd = open(directory.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+#endif
+}
+
+bool Inventory::saveSnapshot(const string& path, string& error) const {
+	INVENTORY_METRIC(SnapshotSave);
+	vector<SnapshotRecord> records;
+	vector<int32_t> reorderLevels;
+	string stringPool;
+	records.reserve(itemStorage.size());
+	reorderLevels.reserve(itemStorage.size() + categoryCount);
+
+	for (size_t row = 0; row < itemStorage.size(); row++) {
+		SnapshotRecord record = {};
+		record.price = priceColumn[row].getCents();
+		record.quantity = quantityColumn[row];
+		record.category = static_cast<uint8_t>(categoryColumn[row]);
+		record.idOffset = static_cast<uint32_t>(stringPool.size());
+		record.idLength = static_cast<uint32_t>(idColumn[row].size());
+		stringPool += idColumn[row];
+		record.nameOffset = static_cast<uint32_t>(stringPool.size());
+		record.nameLength = static_cast<uint32_t>(nameColumn[row].size());
+		stringPool += nameColumn[row];
+		records.push_back(record);
+		reorderLevels.push_back(slots[rowSlots[row]].reorderLevel);
+
+		if (stringPool.size() > numeric_limits<uint32_t>::max()) {
+			error = "String pool is larger than 4 GB.";
+			return false;
+		}
+	}
+
+	reorderLevels.push_back(static_cast<int32_t>(categoryCount));
+	reorderLevels.insert(reorderLevels.end(), begin(categoryReorderLevels), end(categoryReorderLevels));
+
+	SnapshotHeader header = {};
+	memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = snapshotVersion;
+	header.itemCount = records.size();
+	header.stringPoolSize = stringPool.size();
+	uint64_t checksum = fnv1a(records.data(), records.size() * sizeof(SnapshotRecord));
+	checksum = fnv1a(reorderLevels.data(), reorderLevels.size() * sizeof(int32_t), checksum);
+	header.checksum = fnv1a(stringPool.data(), stringPool.size(), checksum);
+
+	// Write and sync a temporary file first, so a crash leaves either the old snapshot or the whole new one
+	string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == nullptr) {
+		error = "Cannot open " + tempPath + " for writing.";
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+	               fwrite(records.data(), sizeof(SnapshotRecord), records.size(), file) == records.size() &&
+	               fwrite(reorderLevels.data(), sizeof(int32_t), reorderLevels.size(), file) == reorderLevels.size() &&
+	               fwrite(stringPool.data(), 1, stringPool.size(), file) == stringPool.size() && fflush(file) == 0;
+#ifdef _WIN32
+	written = written && _commit(_fileno(file)) == 0;
+#else
+	written = written && fsync(fileno(file)) == 0;
+#endif
+	written = fclose(file) == 0 && written;
+	if (!written) {
+		error = "Failed writing " + tempPath + ": " + strerror(errno) + ".";
+		remove(tempPath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+	if (rename(tempPath.c_str(), path.c_str()) != 0) {
+		error = "Cannot replace " + path + ": " + strerror(errno) + ".";
+		remove(tempPath.c_str());
+		return false;
+	}
+	if (!syncDirectory(path)) {
+		error = "Cannot sync the directory of " + path + ": " + strerror(errno) + ".";
+		return false;
+	}
+	return true;
+}
+
+bool Inventory::loadSnapshot(const string& path, string& error) {
+	INVENTORY_METRIC(SnapshotLoad);
+	// Map the whole file, records are read in place without parsing
+#ifndef _WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error = "Cannot open " + path + ".";
+		return false;
+	}
+	struct stat fileInfo;
+	if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+		close(fd);
+		error = "Snapshot " + path + " is truncated.";
+		return false;
+	}
+	size_t fileSize = static_cast<size_t>(fileInfo.st_size);
+	void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		error = "Cannot map " + path + ".";
+		return false;
+	}
+	madvise(mapping, fileSize, MADV_SEQUENTIAL);
+	const char* data = static_cast<const char*>(mapping);
+#else
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file) {
+		error = "Cannot open " + path + ".";
+		return false;
+	}
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	vector<char> buffer(fileSize);
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+	const char* data = buffer.data();
+	if (fileSize < sizeof(SnapshotHeader)) {
+		error = "Snapshot " + path + " is truncated.";
+		return false;
+	}
+#endif
+
+	bool loaded = false;
+	SnapshotHeader header;
+	memcpy(&header, data, sizeof(header));
+	const char* recordData = data + sizeof(header);
+	// Every part is checked against the bytes still left before it is counted, so no size from the file can wrap a sum
+	uint64_t remaining = fileSize - sizeof(header);
+	bool sized = true;
+	auto take = [&remaining, &sized](uint64_t count, uint64_t width) -> size_t {
+		if (!sized || count > remaining / width) {
+			sized = false;
+			return 0;
+		}
+		remaining -= count * width;
+		return static_cast<size_t>(count * width);
+	};
+	size_t recordBytes = take(header.itemCount, sizeof(SnapshotRecord));
+	size_t itemLevelBytes = header.version >= 2 ? take(header.itemCount, sizeof(int32_t)) : 0;
+	size_t countBytes = header.version >= 4 ? take(1, sizeof(int32_t)) : 0;
+	uint32_t fileCategories = header.version >= 2 && header.version < 4 ? legacyCategoryCount : 0;
+	if (countBytes > 0) {
+		memcpy(&fileCategories, recordData + recordBytes + itemLevelBytes, sizeof(fileCategories));
+	}
+	size_t levelBytes = itemLevelBytes + countBytes + take(fileCategories, sizeof(int32_t));
+	take(header.stringPoolSize, 1);
+	const char* levelData = recordData + recordBytes;
+
+	if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0) {
+		error = path + " is not an inventory snapshot.";
+	} else if (header.version < 1 || header.version > snapshotVersion) {
+		error = "Unsupported snapshot version " + to_string(header.version) + ".";
+	} else if (!sized || remaining != 0) {
+		error = "Snapshot " + path + " is truncated.";
+	} else if (fnv1a(levelData + levelBytes, header.stringPoolSize, fnv1a(levelData, levelBytes, fnv1a(recordData, recordBytes))) != header.checksum) {
+		error = "Snapshot " + path + " failed its checksum.";
+	} else {
+		const char* stringPool = levelData + levelBytes;
+		clear();
+		// Categories the file does not know keep the default level, levels of categories no longer registered are dropped
+		for (size_t i = 0; i < categoryCount; i++) {
+			int32_t reorderLevel = defaultReorderLevel;
+			if (i < fileCategories) {
+				memcpy(&reorderLevel, levelData + itemLevelBytes + countBytes + i * sizeof(int32_t), sizeof(reorderLevel));
+			}
+			categoryReorderLevels[i] = reorderLevel;
+		}
+		reserveItems(header.itemCount);
+
+		loaded = true;
+		for (uint64_t i = 0; i < header.itemCount; i++) {
+			SnapshotRecord record;
+			memcpy(&record, recordData + i * sizeof(SnapshotRecord), sizeof(record));
+			Money price = Money::fromCents(record.price);
+			if (header.version < 3) {
+				double oldPrice;
+				memcpy(&oldPrice, &record.price, sizeof(oldPrice));
+				price = Money::fromDouble(oldPrice);
+			}
+			bool corrupt = uint64_t(record.idOffset) + record.idLength > header.stringPoolSize ||
+			               uint64_t(record.nameOffset) + record.nameLength > header.stringPoolSize || record.category >= categoryCount ||
+			               !price.isValidPrice();
+			string id = corrupt ? string() : string(stringPool + record.idOffset, record.idLength);
+			if (corrupt || findItem(id) != nullptr) {
+				error = "Snapshot " + path + (corrupt ? " has a corrupt record." : " repeats the item ID " + id + ".");
+				clear();
+				loaded = false;
+				break;
+			}
+			Item* item = createItem(static_cast<CategoryTag>(record.category), id, string(stringPool + record.nameOffset, record.nameLength),
+			                        record.quantity, price);
+			storeItem(item);
+			if (itemLevelBytes > 0) {
+				int32_t reorderLevel;
+				memcpy(&reorderLevel, levelData + i * sizeof(int32_t), sizeof(reorderLevel));
+				if (reorderLevel != useCategoryReorderLevel) {
+					setItemReorderLevel(item, reorderLevel);
+				}
+			}
+		}
+	}
+
+#ifndef _WIN32
+	munmap(mapping, fileSize);
+#endif
+	return loaded;
+}
+
+bool OperationLog::open(const string& path, string& error) {
+	logPath = path;
+	if (!openFile("ab")) {
+		error = "Cannot open " + path + " for appending.";
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	logSize = static_cast<uint64_t>(ftell(file));
+	return true;
+}
+
+// Unbuffered, records are written in whole group commits anyway, and a failed write leaves nothing queued in the stream
+bool OperationLog::openFile(const char* mode) {
+	file = fopen(logPath.c_str(), mode);
+	if (file == nullptr) {
+		return false;
+	}
+	setvbuf(file, nullptr, _IONBF, 0);
+	return true;
+}
+
+void OperationLog::append(LogOperation operation, const Item* item, CategoryTag category) {
+	const size_t maxLength = numeric_limits<uint16_t>::max();
+	string_view id = item->getItemID();
+	string_view name = item->getItemName();
+	RecordHeader header = {};
+	header.operation = static_cast<uint8_t>(operation);
+	header.category = static_cast<uint8_t>(category);
+	header.flags = centPrices;
+	header.quantity = item->getItemQuantity();
+	header.price = item->getItemPrice().getCents();
+	appendRecord(header, id.substr(0, maxLength), operation == LogOperation::Add ? name.substr(0, maxLength) : string_view());
+}
+
+// The level travels in the quantity field
+void OperationLog::appendReorderLevel(LogOperation operation, CategoryTag category, string_view id, int reorderLevel) {
+	RecordHeader header = {};
+	header.operation = static_cast<uint8_t>(operation);
+	header.category = static_cast<uint8_t>(category);
+	header.flags = centPrices;
+	header.quantity = reorderLevel;
+	appendRecord(header, id.substr(0, numeric_limits<uint16_t>::max()), string_view());
+}
+
+// Stamps the checksum and queues the record for the next group commit
+void OperationLog::appendRecord(RecordHeader& header, string_view id, string_view name) {
+	header.idLength = static_cast<uint16_t>(id.size());
+	header.nameLength = static_cast<uint16_t>(name.size());
+	size_t start = pending.size();
+	pending.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	pending.append(id.data(), id.size());
+	pending.append(name.data(), name.size());
+
+	uint64_t checksum = fnv1a(pending.data() + start + sizeof(uint32_t), pending.size() - start - sizeof(uint32_t));
+	uint32_t shortChecksum = static_cast<uint32_t>(checksum ^ (checksum >> 32));
+	memcpy(&pending[start], &shortChecksum, sizeof(shortChecksum));
+
+	if (++pendingRecords >= groupCommitRecords) {
+		commit();
+	}
+}
+
+// Writes every pending record and flushes them to disk with one fsync
+// A failed write is cut back to the last good commit, so the next commit writes the same records again
+bool OperationLog::commit() {
+	if (pending.empty()) {
+		return true;
+	}
+	if (file == nullptr && !openFile("ab")) {
+		commitError = "Cannot open " + logPath + " for appending.";
+		return false;
+	}
+	bool written = fwrite(pending.data(), 1, pending.size(), file) == pending.size() && fflush(file) == 0;
+#ifdef _WIN32
+	written = written && _commit(_fileno(file)) == 0;
+#else
+	written = written && fsync(fileno(file)) == 0;
+#endif
+	if (!written) {
+		commitError = "Cannot write " + logPath + ": " + strerror(errno);
+		clearerr(file);
+#ifdef _WIN32
+		_chsize_s(_fileno(file), static_cast<long long>(logSize));
+#else
+		if (ftruncate(fileno(file), static_cast<off_t>(logSize)) != 0) {
+			commitError += ", and a partial record may remain";
+		}
+#endif
+		return false;
+	}
+	logSize += pending.size();
+	pending.clear();
+	pendingRecords = 0;
+	commitError.clear();
+	return true;
+}
+
+// Applies every complete record, stopping at the first torn or corrupt one
+bool OperationLog::replay(Inventory& inventory, string& error) {
+	ifstream input(logPath, ios::binary);
+	if (!input) {
+		return true; // No log yet
+	}
+	string data((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+
+	size_t position = 0;
+	while (position + sizeof(RecordHeader) <= data.size()) {
+		RecordHeader header;
+		memcpy(&header, data.data() + position, sizeof(header));
+		size_t recordSize = sizeof(header) + header.idLength + header.nameLength;
+		if (position + recordSize > data.size()) {
+			break;
+		}
+		uint64_t checksum = fnv1a(data.data() + position + sizeof(uint32_t), recordSize - sizeof(uint32_t));
+		if (static_cast<uint32_t>(checksum ^ (checksum >> 32)) != header.checksum || header.category >= categoryCount) {
+			break;
+		}
+
+		string id(data.data() + position + sizeof(header), header.idLength);
+		Item* item = inventory.findItem(id);
+		Money price = Money::fromCents(header.price);
+		if ((header.flags & centPrices) == 0) {
+			double oldPrice; // Written before prices were fixed-point
+			memcpy(&oldPrice, &header.price, sizeof(oldPrice));
+			price = Money::fromDouble(oldPrice);
+		}
+		LogOperation operation = static_cast<LogOperation>(header.operation);
+		if ((operation == LogOperation::Add || operation == LogOperation::SetPrice) && !price.isValidPrice()) {
+			break; // No entry path accepts such a price, so the record is corrupt
+		}
+		switch (operation) {
+			case LogOperation::Add:
+				if (item == nullptr) {
+					string name(data.data() + position + sizeof(header) + header.idLength, header.nameLength);
+					inventory.storeItem(inventory.createItem(static_cast<CategoryTag>(header.category), id, name, header.quantity, price));
+				}
+				break;
+			case LogOperation::SetQuantity:
+				if (item != nullptr) {
+					inventory.setItemQuantity(item, header.quantity);
+				}
+				break;
+			case LogOperation::SetPrice:
+				if (item != nullptr) {
+					inventory.setItemPrice(item, price);
+				}
+				break;
+			case LogOperation::Remove:
+				if (item != nullptr) {
+					inventory.unstoreItem(item);
+					inventory.destroyItem(item);
+				}
+				break;
+			case LogOperation::SetReorderLevel:
+				if (item != nullptr) {
+					inventory.setItemReorderLevel(item, header.quantity);
+				}
+				break;
+			case LogOperation::SetCategoryReorderLevel:
+				inventory.setCategoryReorderLevel(static_cast<CategoryTag>(header.category), header.quantity);
+				break;
+		}
+		position += recordSize;
+	}
+
+	if (position != data.size()) {
+		error = "Ignored " + to_string(data.size() - position) + " bytes of incomplete log records.";
+		return false;
+	}
+	return true;
+}
+
+// Empties the log once its records are covered by a snapshot, call it only after saveSnapshot returned true
+// since that is when the snapshot is synced, and the truncation is synced too so old records never outlive it
+bool OperationLog::reset() {
+	pending.clear();
+	pendingRecords = 0;
+	commitError.clear();
+	if (file != nullptr) {
+		fclose(file);
+	}
+	logSize = 0;
+	if (!openFile("wb")) {
+		return false; // The next commit tries to open it again
+	}
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+void Inventory::logMutation(LogOperation operation, const Item* item) {
+	if (operationLog != nullptr) {
+		operationLog->append(operation, item, getCategoryTag(item));
+	}
+}
+
+void Inventory::logReorderLevel(LogOperation operation, CategoryTag tag, string_view id, int reorderLevel) {
+	if (operationLog != nullptr) {
+		operationLog->appendReorderLevel(operation, tag, id, reorderLevel);
+	}
+}
+
+void Inventory::attachLog(OperationLog* log, const string& snapshotFile) {
+	operationLog = log;
+	snapshotPath = snapshotFile;
+}
+
+// Group commit point, also compacts the log into a new snapshot once it grows too large
+// A snapshot also covers records that could not be written, so saving one clears a failed commit
+bool Inventory::syncLog(string& error) {
+	if (operationLog == nullptr) {
+		return true;
+	}
+	bool committed = operationLog->commit();
+	if (!committed) {
+		error = operationLog->lastError();
+	}
+	if (operationLog->needsCompaction()) {
+		string snapshotError;
+		if (saveSnapshot(snapshotPath, snapshotError)) {
+			operationLog->reset(); // The snapshot is synced, so the log is no longer needed
+			committed = true;
+		}
+	}
+	return committed;
+}
+
+// Batch mode reads one command per line, tokens are separated by spaces and names may be quoted
+//   add <category> <id> <name> <quantity> <price>
+//   update <id> quantity|price <value>
+//   update <id> reorder <level>|default
+//   adjust <id> <delta>
+//   reorder <category> <level>
+//   remove <id> [<id>...]
+//   query <id>
+//   search <text> [<limit>]
+//   value [<category>]
+bool splitBatchLine(string_view line, vector<string_view>& tokens) {
+	tokens.clear();
+	size_t position = 0;
+	while (position < line.size()) {
+		if (line[position] == ' ' || line[position] == '\t' || line[position] == '\r') {
+			position++;
+		} else if (line[position] == '"') {
+			size_t closing = line.find('"', position + 1);
+			if (closing == string_view::npos) {
+				return false; // Unterminated quote
+			}
+			tokens.push_back(line.substr(position + 1, closing - position - 1));
+			position = closing + 1;
+		} else {
+			size_t end = line.find_first_of(" \t\r", position);
+			if (end == string_view::npos) {
+				end = line.size();
+			}
+			tokens.push_back(line.substr(position, end - position));
+			position = end;
+		}
+	}
+	return true;
+}
+
+void appendPrice(string& output, Money price) {
+	char buffer[Money::maxFormattedLength];
+	output.append(buffer, price.format(buffer, buffer + sizeof(buffer)));
+}
+
+void appendPrice(string& output, const MoneyTotal& total) {
+	if (total.fitsMoney()) {
+		appendPrice(output, total.toMoney());
+	} else {
+		output += total.toString();
+	}
+}
+
+// Applies every command without prompts, returns the number of failed commands
+size_t Inventory::runBatch(string_view commands, string& report) {
+	INVENTORY_METRIC(Batch);
+	const size_t commandsPerLock = 256; // Lets other threads in between blocks of commands
+	vector<string_view> tokens;
+	size_t lineNumber = 0, failed = 0, locked = 0;
+	size_t position = 0;
+	size_t adds = commands.compare(0, 4, "add ") == 0 ? 1 : 0;
+	for (size_t newline = commands.find('\n'); newline != string_view::npos; newline = commands.find('\n', newline + 1)) {
+		adds += commands.compare(newline + 1, 4, "add ") == 0 ? 1 : 0;
+	}
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	reserveItems(adds); // Large batches of adds would otherwise rehash the ID index several times
+
+	while (position < commands.size()) {
+		size_t end = commands.find('\n', position);
+		if (end == string_view::npos) {
+			end = commands.size();
+		}
+		string_view line = commands.substr(position, end - position);
+		position = end + 1;
+		lineNumber++;
+
+		bool validLine = splitBatchLine(line, tokens);
+		if (validLine && (tokens.empty() || (!tokens[0].empty() && tokens[0][0] == '#'))) {
+			continue; // Blank lines and comments are not reported
+		}
+
+		char number[24];
+		report.append(number, to_chars(number, number + sizeof(number), lineNumber).ptr);
+		report += ": ";
+		if (!validLine) {
+			report += "error unterminated quote";
+			failed++;
+		} else if (!runBatchCommand(tokens, report)) {
+			failed++;
+		}
+		report += '\n';
+
+		if (++locked == commandsPerLock) {
+			lock.unlock();
+			lock.lock();
+			applyPendingAdjustments();
+			locked = 0;
+		}
+	}
+	string error;
+	if (!syncLog(error)) {
+		report += "log: error " + error + '\n'; // The changes above are not durable yet
+		failed++;
+	}
+	return failed;
+}
+
+// One batch line, runBatch holds the exclusive lock around it
+bool Inventory::runBatchCommand(const vector<string_view>& tokens, string& report) {
+	string_view command = tokens[0];
+
+	if (command == "add") {
+		if (tokens.size() != 6) {
+			report += "error usage: add <category> <id> <name> <quantity> <price>";
+			return false;
+		}
+		CategoryTag tag;
+		if (!parseCategoryCode(tokens[1], tag)) {
+			report += "error category must be " + categoryCodeChoices();
+			return false;
+		}
+
+		string id = getCategoryCode(tag) + string(tokens[2]);
+		int quantity = 0;
+		Money price;
+		if (!isValidID(tokens[2])) {
+			report += "error id must be alphanumeric";
+			return false;
+		}
+		toLowerCase(id);
+		if (isIDTaken(id)) {
+			report += "error id " + id + " is already taken";
+			return false;
+		}
+		if (tokens[3].empty()) {
+			report += "error name is empty";
+			return false;
+		}
+		if (!parseNumber(tokens[4], quantity) || quantity <= 0) {
+			report += "error quantity must be a positive whole number";
+			return false;
+		}
+		if (!Money::parsePrice(tokens[5], price)) {
+			report += "error price must be " + priceRequirement();
+			return false;
+		}
+		storeItem(createItem(tag, id, capitalizeFirstLetter(string(tokens[3])), quantity, price));
+		report += "ok added " + id;
+		return true;
+	}
+
+	if (command == "reorder") {
+		CategoryTag tag;
+		int reorderLevel = 0;
+		if (tokens.size() != 3) {
+			report += "error usage: reorder <category> <level>";
+			return false;
+		}
+		if (!parseCategoryCode(tokens[1], tag)) {
+			report += "error category must be " + categoryCodeChoices();
+			return false;
+		}
+		if (!parseNumber(tokens[2], reorderLevel) || reorderLevel < 0) {
+			report += "error reorder level must be a whole number";
+			return false;
+		}
+		setCategoryReorderLevel(tag, reorderLevel);
+		report += "ok reorder level of " + string(getCategoryName(tag)) + " is " + to_string(reorderLevel);
+		return true;
+	}
+
+	// Relative change that refuses to leave the quantity below zero
+	if (command == "adjust") {
+		int delta = 0;
+		if (tokens.size() != 3) {
+			report += "error usage: adjust <id> <delta>";
+			return false;
+		}
+		bool negative = !tokens[2].empty() && tokens[2][0] == '-';
+		bool signedDelta = negative || (!tokens[2].empty() && tokens[2][0] == '+');
+		if (!parseNumber(signedDelta ? tokens[2].substr(1) : tokens[2], delta)) {
+			report += "error delta must be a whole number";
+			return false;
+		}
+		string id(tokens[1]);
+		toLowerCase(id);
+		Item* item = findItem(id);
+		if (item == nullptr) {
+			report += "error item " + id + " not found";
+			return false;
+		}
+		long long quantity = static_cast<long long>(item->getItemQuantity()) + (negative ? -static_cast<long long>(delta) : delta);
+		if (quantity < 0 || quantity > numeric_limits<int>::max()) {
+			report += "error quantity of " + id + " would become " + to_string(quantity);
+			return false;
+		}
+		setItemQuantity(item, static_cast<int>(quantity));
+		report += "ok " + id + " " + to_string(quantity);
+		return true;
+	}
+
+	// Reports the ranked IDs, best match first
+	if (command == "search") {
+		size_t limit = nameSearchLimit;
+		if (tokens.size() < 2 || tokens.size() > 3 || tokens[1].empty()) {
+			report += "error usage: search <text> [<limit>]";
+			return false;
+		}
+		if (tokens.size() == 3 && !parseNumber(tokens[2], limit)) {
+			report += "error limit must be a whole number";
+			return false;
+		}
+		size_t matchCount = 0;
+		vector<Item*> matches = searchNames(tokens[1], limit, &matchCount);
+		report += "ok " + to_string(matchCount);
+		for (const Item* item : matches) {
+			report += ' ';
+			report += item->getItemID();
+		}
+		return true;
+	}
+
+	// Reports the IDs of the matching items, the rest of the line is the query
+	if (command == "find") {
+		string text, error;
+		for (size_t i = 1; i < tokens.size(); i++) {
+			bool quoted = tokens[i].find_first_of(" \t") != string_view::npos; // The batch splitter removed the quotes
+			text += i > 1 ? " " : "";
+			text += quoted ? "\"" + string(tokens[i]) + "\"" : string(tokens[i]);
+		}
+		ItemQuery query;
+		if (!parseQuery(text, query, error)) {
+			report += "error " + error;
+			return false;
+		}
+		QueryResult result = runQuery(query);
+		report += "ok " + to_string(result.items.size());
+		for (const Item* item : result.items) {
+			report += ' ';
+			report += item->getItemID();
+		}
+		return true;
+	}
+
+	// Item count, total quantity, stock value and price range of one category or of everything
+	if (command == "value") {
+		CategoryTag tag = CategoryTag::Clothing;
+		if (tokens.size() > 2) {
+			report += "error usage: value [<category>]";
+			return false;
+		}
+		if (tokens.size() == 2 && !parseCategoryCode(tokens[1], tag)) {
+			report += "error category must be " + categoryCodeChoices();
+			return false;
+		}
+		InventoryValuation valuation = valuateColumns(quantityColumn.data(), priceColumn.data(), categoryColumn.data(), categoryColumn.size());
+		const ValuationTotals& totals = tokens.size() == 2 ? valuation.categories[static_cast<size_t>(tag)] : valuation.overall;
+		report += "ok items " + to_string(totals.itemCount) + " quantity " + to_string(totals.totalQuantity) + " value ";
+		appendPrice(report, totals.totalValue);
+		report += " min ";
+		appendPrice(report, totals.minPrice);
+		report += " average ";
+		appendPrice(report, totals.averagePrice());
+		report += " max ";
+		appendPrice(report, totals.maxPrice);
+		return true;
+	}
+
+	// Several IDs are removed together with a single compaction, the IDs that are not found fail the command
+	if (command == "remove" && tokens.size() > 2) {
+		vector<string> ids(tokens.begin() + 1, tokens.end());
+		vector<string> missing;
+		size_t removed = removeIds(ids, missing);
+		if (!missing.empty()) {
+			report += "error removed " + to_string(removed) + " of " + to_string(ids.size()) + ", not found:";
+			for (const string& id : missing) {
+				report += ' ' + id;
+			}
+			return false;
+		}
+		report += "ok removed " + to_string(removed);
+		return true;
+	}
+
+	if (command == "update" || command == "remove" || command == "query") {
+		if (tokens.size() < 2) {
+			report += "error missing id";
+			return false;
+		}
+		string id(tokens[1]);
+		toLowerCase(id);
+		Item* item = findItem(id);
+		if (item == nullptr) {
+			report += "error item " + id + " not found";
+			return false;
+		}
+
+		if (command == "remove") {
+			unstoreItem(item);
+			destroyItem(item);
+			report += "ok removed " + id;
+		} else if (command == "query") {
+			report += "ok ";
+			report += id;
+			report += ' ';
+			report += item->getItemName();
+			report += ' ';
+			report += to_string(item->getItemQuantity());
+			report += ' ';
+			appendPrice(report, item->getItemPrice());
+			report += ' ';
+			report += getCategory(item);
+		} else {
+			if (tokens.size() != 4) {
+				report += "error usage: update <id> quantity|price|reorder <value>";
+				return false;
+			}
+			if (tokens[2] == "quantity" || tokens[2] == "q") {
+				int quantity = 0;
+				if (!parseNumber(tokens[3], quantity)) {
+					report += "error quantity must be a whole number";
+					return false;
+				}
+				setItemQuantity(item, quantity);
+			} else if (tokens[2] == "price" || tokens[2] == "p") {
+				Money price;
+				if (!Money::parsePrice(tokens[3], price)) {
+					report += "error price must be " + priceRequirement();
+					return false;
+				}
+				setItemPrice(item, price);
+			} else if (tokens[2] == "reorder" || tokens[2] == "r") {
+				int reorderLevel = useCategoryReorderLevel;
+				if (tokens[3] != "default" && (!parseNumber(tokens[3], reorderLevel) || reorderLevel < 0)) {
+					report += "error reorder level must be a whole number or default";
+					return false;
+				}
+				setItemReorderLevel(item, reorderLevel);
+			} else {
+				report += "error field must be quantity, price or reorder";
+				return false;
+			}
+			report += "ok updated " + id;
+		}
+		return true;
+	}
+
+	report += "error unknown command ";
+	report += command;
+	return false;
+}
+
+// CSV columns are category,id,name,quantity,price, names containing commas or quotes are quoted
+// The id is the full ID, category code first such as cl42, as the export writes it and every other way in stores it
+struct CsvRecord {
+	CategoryTag category;
+	string_view id;
+	string_view name;
+	bool quotedName; // Name still holds doubled quotes
+	int quantity;
+	Money price;
+	size_t line; // Line number within the parsed slice
+};
+
+struct CsvSlice {
+	vector<CsvRecord> records;
+	vector<pair<size_t, string>> errors;
+	size_t lines = 0;
+};
+
+// Splits a line into fields without copying, returns false on a malformed quote
+bool splitCsvLine(string_view line, string_view* fields, size_t fieldCount, size_t& found, bool& quotedLast) {
+	found = 0;
+	quotedLast = false;
+	size_t position = 0;
+	while (found < fieldCount) {
+		bool quoted = position < line.size() && line[position] == '"';
+		size_t end;
+		if (quoted) {
+			end = position + 1;
+			while (true) {
+				end = line.find('"', end);
+				if (end == string_view::npos) {
+					return false;
+				}
+				if (end + 1 < line.size() && line[end + 1] == '"') {
+					end += 2; // Escaped quote
+				} else {
+					break;
+				}
+			}
+			fields[found++] = line.substr(position + 1, end - position - 1);
+			end++;
+			if (end < line.size() && line[end] != ',') {
+				return false;
+			}
+		} else {
+			end = line.find(',', position);
+			if (end == string_view::npos) {
+				end = line.size();
+			}
+			fields[found++] = line.substr(position, end - position);
+		}
+		quotedLast = quoted;
+		if (end >= line.size()) {
+			return true;
+		}
+		position = end + 1;
+	}
+	return position >= line.size(); // Extra columns
+}
+
+// Parses one slice of complete lines, run on a worker thread per slice
+// Only the slice at the start of the file may begin with the header row
+void parseCsvSlice(string_view slice, bool startsFile, CsvSlice& result) {
+	string_view fields[5];
+	size_t position = 0;
+	while (position < slice.size()) {
+		size_t end = slice.find('\n', position);
+		if (end == string_view::npos) {
+			end = slice.size();
+		}
+		string_view line = slice.substr(position, end - position);
+		position = end + 1;
+		result.lines++;
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (line.empty()) {
+			continue;
+		}
+
+		size_t found = 0;
+		bool quotedName = false;
+		CsvRecord record;
+		record.line = result.lines;
+		if (!splitCsvLine(line, fields, 5, found, quotedName) || found != 5) {
+			result.errors.emplace_back(result.lines, "expected 5 columns");
+			continue;
+		}
+		record.quotedName = quotedName || fields[2].find('"') != string_view::npos;
+		if (!Inventory::parseCategoryCode(fields[0], record.category)) {
+			if (startsFile && result.lines == 1 && fields[0] == "category") {
+				continue; // Header row
+			}
+			result.errors.emplace_back(result.lines, "category must be " + categoryCodeChoices());
+			continue;
+		}
+		if (!Inventory::isValidID(fields[1])) {
+			result.errors.emplace_back(result.lines, "id must be alphanumeric");
+			continue;
+		}
+		string_view code = Inventory::getCategoryCode(record.category);
+		CategoryTag prefix;
+		if (fields[1].size() <= code.size() || !Inventory::parseCategoryCode(fields[1].substr(0, code.size()), prefix) || prefix != record.category) {
+			result.errors.emplace_back(result.lines, "id must start with the category code " + string(code));
+			continue;
+		}
+		if (fields[2].empty()) {
+			result.errors.emplace_back(result.lines, "name is empty");
+			continue;
+		}
+		if (!Inventory::isAllDigits(fields[3]) || !parseNumber(fields[3], record.quantity) || record.quantity <= 0) {
+			result.errors.emplace_back(result.lines, "quantity must be a positive whole number");
+			continue;
+		}
+		if (!Money::parsePrice(fields[4], record.price)) {
+			result.errors.emplace_back(result.lines, "price must be " + priceRequirement());
+			continue;
+		}
+		record.id = fields[1];
+		record.name = fields[2];
+		result.records.push_back(record);
+	}
+}
+
+// Streams the file in chunks, parses each chunk on all cores and merges it in one pass
+CsvImportResult Inventory::importCsv(const string& path) {
+	INVENTORY_METRIC(Import);
+	const size_t chunkSize = max<size_t>(1, csvChunkSize);
+	const size_t maxReportedErrors = 20;
+	CsvImportResult result;
+	auto started = chrono::steady_clock::now();
+
+	ifstream input(path, ios::binary);
+	if (!input) {
+		result.failure = "Cannot open " + path + ".";
+		return result;
+	}
+
+	// Bulk loads skip the log, the result is written as one snapshot at the end
+	size_t threadCount = max<size_t>(1, thread::hardware_concurrency());
+	vector<char> buffer;
+	string carry; // Partial last line of the previous chunk
+	size_t lineOffset = 0;
+	string id, name;
+
+	while (input || !carry.empty()) {
+		buffer.assign(carry.begin(), carry.end());
+		size_t carried = buffer.size();
+		buffer.resize(carried + chunkSize);
+		input.read(buffer.data() + carried, chunkSize);
+		size_t length = carried + static_cast<size_t>(input.gcount());
+		buffer.resize(length);
+		result.bytes += static_cast<uint64_t>(input.gcount());
+		carry.clear();
+
+		// Keep the unfinished line for the next chunk
+		if (input) {
+			auto lastNewline = find(buffer.rbegin(), buffer.rend(), '\n');
+			size_t complete = buffer.rend() - lastNewline;
+			carry.assign(buffer.begin() + complete, buffer.end());
+			buffer.resize(complete);
+		}
+		if (buffer.empty()) {
+			if (!input) break;
+			continue;
+		}
+
+		// Cut the chunk into slices that end on line boundaries
+		string_view chunk(buffer.data(), buffer.size());
+		vector<string_view> slices;
+		size_t sliceStart = 0;
+		for (size_t i = 1; i <= threadCount && sliceStart < chunk.size(); i++) {
+			size_t newline = chunk.find('\n', max(sliceStart, chunk.size() * i / threadCount));
+			size_t sliceEnd = i == threadCount || newline == string_view::npos ? chunk.size() : newline + 1;
+			slices.push_back(chunk.substr(sliceStart, sliceEnd - sliceStart));
+			sliceStart = sliceEnd;
+		}
+
+		vector<CsvSlice> parsed(slices.size());
+		vector<thread> workers;
+		for (size_t i = 1; i < slices.size(); i++) {
+			workers.emplace_back(parseCsvSlice, slices[i], false, ref(parsed[i]));
+		}
+		parseCsvSlice(slices[0], lineOffset == 0, parsed[0]); // No line was merged before the first chunk
+		for (thread& worker : workers) {
+			worker.join();
+		}
+
+		// Merge in file order so the first occurrence of a duplicate ID wins, other threads wait only for the merge
+		unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+		applyPendingAdjustments();
+		size_t parsedRecords = 0;
+		for (const CsvSlice& slice : parsed) {
+			parsedRecords += slice.records.size();
+		}
+		reserveItems(parsedRecords);
+		for (const CsvSlice& slice : parsed) {
+			for (const auto& error : slice.errors) {
+				result.rejected++;
+				if (result.errors.size() < maxReportedErrors) {
+					result.errors.push_back("line " + to_string(lineOffset + error.first) + ": " + error.second);
+				}
+			}
+			for (const CsvRecord& record : slice.records) {
+				id.assign(record.id.data(), record.id.size());
+				toLowerCase(id);
+				if (isIDTaken(id)) {
+					result.rejected++;
+					if (result.errors.size() < maxReportedErrors) {
+						result.errors.push_back("line " + to_string(lineOffset + record.line) + ": duplicate id " + id);
+					}
+					continue;
+				}
+				name.assign(record.name.data(), record.name.size());
+				if (record.quotedName) {
+					size_t quote = 0;
+					while ((quote = name.find("\"\"", quote)) != string::npos) {
+						name.erase(quote, 1);
+						quote++;
+					}
+				}
+				storeItem(createItem(record.category, id, capitalizeFirstLetter(name), record.quantity, record.price), false);
+				result.imported++;
+			}
+			lineOffset += slice.lines;
+		}
+	}
+
+	unique_lock<ShardedSharedMutex> lock(inventoryMutex);
+	applyPendingAdjustments();
+	if (operationLog != nullptr && result.imported > 0) {
+		string error;
+		operationLog->commit(); // Only earlier changes, the snapshot covers them either way
+		if (saveSnapshot(snapshotPath, error)) {
+			operationLog->reset(); // Only once the snapshot is synced, a failed save keeps every record
+		} else {
+			result.saveError = error;
+		}
+	}
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	return result;
+}
+
+bool Inventory::exportCsv(const string& path, double& megabytesPerSecond, string& error) const {
+	INVENTORY_METRIC(Export);
+	const size_t flushSize = 1 << 20;
+	auto started = chrono::steady_clock::now();
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		error = "Cannot open " + path + " for writing.";
+		return false;
+	}
+
+	string buffer = "category,id,name,quantity,price\n";
+	uint64_t written = 0;
+	bool ok = true;
+	char number[24];
+	for (size_t row = 0; row < itemStorage.size(); row++) {
+		string_view itemName = nameColumn[row];
+		buffer += getCategoryCode(categoryColumn[row]);
+		buffer += ',';
+		buffer += idColumn[row];
+		buffer += ',';
+		if (itemName.find_first_of(",\"") != string_view::npos) {
+			buffer += '"';
+			for (char c : itemName) {
+				if (c == '"') buffer += '"';
+				buffer += c;
+			}
+			buffer += '"';
+		} else {
+			buffer += itemName;
+		}
+		buffer += ',';
+		buffer.append(number, to_chars(number, number + sizeof(number), quantityColumn[row]).ptr);
+		buffer += ',';
+		appendPrice(buffer, priceColumn[row]);
+		buffer += '\n';
+
+		if (buffer.size() >= flushSize) {
+			ok = ok && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+			written += buffer.size();
+			buffer.clear();
+		}
+	}
+	ok = ok && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	written += buffer.size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok) {
+		error = "Failed writing " + path + ".";
+		return false;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	megabytesPerSecond = seconds > 0 ? written / 1e6 / seconds : 0;
+	return true;
+}
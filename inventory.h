@@ -0,0 +1,994 @@
+// Inventory engine: storage, indexes, search, sorting, persistence and bulk I/O, without any console prompts
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <string>
+#include <limits>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <deque>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <tuple>
+#include <functional>
+#include <string_view>
+#include <charconv>
+#include <atomic>
+#include <shared_mutex>
+#include "inventory_metrics.h"
+using namespace std;
+
+// Amount of money in whole cents, so sums and comparisons are exact
+class Money {
+	private:
+		int64_t cents = 0;
+
+	public:
+		static const size_t maxFormattedLength = 24; // Sign, 18 digits, point and two decimals fit
+		// Largest item price, 1000000.00, so a price times any int quantity stays below 2.2e17 cents and fits 32 bits itself
+		// Totals of many stock values can still pass the int64 range, they are kept in a MoneyTotal
+		static constexpr int64_t maxPriceCents = 100000000;
+
+		constexpr Money() = default;
+		static constexpr Money fromCents(int64_t amount) {
+			Money money;
+			money.cents = amount;
+			return money;
+		}
+		static Money fromDouble(double amount); // Nearest cent, for files written before prices were fixed-point
+		constexpr int64_t getCents() const {
+			return cents;
+		}
+
+		// Digits with at most two decimals and no sign, such as "12", "12.5" or ".99"
+		static bool parse(string_view text, Money& amount);
+		// Like parse, but only positive amounts up to maxPriceCents, as item prices are entered
+		static bool parsePrice(string_view text, Money& price);
+		constexpr bool isValidPrice() const {
+			return cents > 0 && cents <= maxPriceCents;
+		}
+		// Writes the amount with two decimals, such as "-12.50", and returns the end like to_chars
+		char* format(char* first, char* last) const;
+		string toString() const;
+
+		constexpr bool operator==(Money other) const {
+			return cents == other.cents;
+		}
+		constexpr bool operator!=(Money other) const {
+			return cents != other.cents;
+		}
+		constexpr bool operator<(Money other) const {
+			return cents < other.cents;
+		}
+		constexpr bool operator>(Money other) const {
+			return cents > other.cents;
+		}
+		constexpr bool operator<=(Money other) const {
+			return cents <= other.cents;
+		}
+		constexpr bool operator>=(Money other) const {
+			return cents >= other.cents;
+		}
+		constexpr Money operator+(Money other) const {
+			return fromCents(cents + other.cents);
+		}
+		constexpr Money operator-(Money other) const {
+			return fromCents(cents - other.cents);
+		}
+		constexpr Money operator*(long long count) const { // Item prices times quantities never overflow, see maxPriceCents
+			return fromCents(cents * count);
+		}
+		Money& operator+=(Money other) {
+			cents += other.cents;
+			return *this;
+		}
+		Money& operator-=(Money other) {
+			cents -= other.cents;
+			return *this;
+		}
+};
+static_assert(sizeof(Money) == sizeof(int64_t), "Money columns are scanned as plain 64-bit integers");
+
+// Exact sum of stock values in 128-bit two's complement, no count of items at any price and quantity can overflow it
+// Adding and subtracting the same amounts always returns to the same total, so running totals never drift
+class MoneyTotal {
+	private:
+		uint64_t low = 0;
+		uint64_t high = 0;
+
+		void addWide(uint64_t addLow, uint64_t addHigh) {
+			low += addLow;
+			high += addHigh + (low < addLow);
+		}
+
+	public:
+		MoneyTotal() = default;
+		MoneyTotal(Money amount) {
+			*this += amount;
+		}
+
+		MoneyTotal& operator+=(Money amount) {
+			int64_t cents = amount.getCents();
+			addWide(static_cast<uint64_t>(cents), cents < 0 ? ~uint64_t(0) : 0);
+			return *this;
+		}
+		MoneyTotal& operator-=(Money amount) {
+			int64_t cents = amount.getCents();
+			uint64_t borrow = low < static_cast<uint64_t>(cents);
+			low -= static_cast<uint64_t>(cents);
+			high -= (cents < 0 ? ~uint64_t(0) : 0) + borrow;
+			return *this;
+		}
+		MoneyTotal& operator+=(const MoneyTotal& other) {
+			addWide(other.low, other.high);
+			return *this;
+		}
+		MoneyTotal& addTimes(Money amount, uint32_t count); // Adds amount * count exactly
+
+		bool operator==(const MoneyTotal& other) const {
+			return low == other.low && high == other.high;
+		}
+		bool operator!=(const MoneyTotal& other) const {
+			return !(*this == other);
+		}
+
+		bool fitsMoney() const {
+			return high == (static_cast<int64_t>(low) < 0 ? ~uint64_t(0) : 0);
+		}
+		Money toMoney() const; // Saturates at the Money limits
+		string toString() const; // Every digit, also past the Money range
+};
+
+// Category registry, one line per category: tag, two-letter code and display name
+// A new line adds the tag, the table entry, the item class <Tag>Item, its pool and its factory
+#define INVENTORY_CATEGORIES(CATEGORY) \
+	CATEGORY(Clothing, "cl", "Clothing") \
+	CATEGORY(Electronics, "el", "Electronics") \
+	CATEGORY(Entertainment, "en", "Entertainment")
+
+// Compact category tag, stored in every item so dispatch is a table index instead of a dynamic_cast
+#define INVENTORY_CATEGORY_TAG(tag, code, name) tag,
+enum class CategoryTag : uint8_t { INVENTORY_CATEGORIES(INVENTORY_CATEGORY_TAG) };
+#undef INVENTORY_CATEGORY_TAG
+
+// One entry per category in tag order, category listings and code parsing walk this table
+struct CategoryInfo {
+	CategoryTag tag;
+	const char* code;
+	const char* name;
+};
+
+#define INVENTORY_CATEGORY_INFO(tag, code, name) {CategoryTag::tag, code, name},
+constexpr CategoryInfo categoryTable[] = { INVENTORY_CATEGORIES(INVENTORY_CATEGORY_INFO) };
+#undef INVENTORY_CATEGORY_INFO
+constexpr size_t categoryCount = sizeof(categoryTable) / sizeof(categoryTable[0]);
+
+constexpr int compareCategoryNames(const char* a, const char* b) {
+	while (*a != '\0' && *a == *b) {
+		a++;
+		b++;
+	}
+	return static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
+}
+
+// Codes and names are parsed back into tags, so two entries may never share either
+constexpr bool categoryRegistryUnique() {
+	for (size_t i = 0; i < categoryCount; i++) {
+		for (size_t j = i + 1; j < categoryCount; j++) {
+			if (compareCategoryNames(categoryTable[i].code, categoryTable[j].code) == 0 ||
+			    compareCategoryNames(categoryTable[i].name, categoryTable[j].name) == 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+static_assert(categoryRegistryUnique(), "Every category needs its own code and name");
+
+// Position of each category in name order, so sorting by category never compares strings
+struct CategoryNameRanks {
+	uint8_t ranks[categoryCount] = {};
+	constexpr CategoryNameRanks() {
+		for (size_t i = 0; i < categoryCount; i++) {
+			for (size_t j = 0; j < categoryCount; j++) {
+				if (compareCategoryNames(categoryTable[j].name, categoryTable[i].name) < 0) {
+					ranks[i]++;
+				}
+			}
+		}
+	}
+	constexpr uint8_t operator[](CategoryTag tag) const {
+		return ranks[static_cast<size_t>(tag)];
+	}
+};
+constexpr CategoryNameRanks categoryNameRank;
+
+// Abstract Base Class
+class Item {
+	protected:
+		string itemID;	// Encapsulation, stored lowercase
+		string itemName;
+		int itemQuantity;
+		CategoryTag itemCategory; // Fits in the padding before the price
+		Money itemPrice;
+
+	public:
+		// Virtual destructor to delete from the base and derived classes
+		virtual ~Item() = default;
+
+		// Constructor parameters are assigned to corresponding class attributes
+		Item(CategoryTag category, const string& id, const string& name, int quantity, Money price)
+			: itemID(id), itemName(name), itemQuantity(quantity), itemCategory(category), itemPrice(price) { // Initializers match the constructor's parameters
+			for (char& c : itemID) {
+				c = tolower(c); // Normalize the ID once so getters never copy
+			}
+		}
+
+		// Pure virtual function to name the item category
+		virtual const char* getItemCategory() const = 0;
+
+		// Setters
+		void setQuantity(int newQuantity) {
+			itemQuantity = newQuantity;    // Considering adding edit name
+		}
+		void setPrice(Money newPrice) {
+			itemPrice = newPrice;
+		}
+
+		// Getters return protected attributes
+		const string& getItemID() const {
+			return itemID;
+		}
+		const string& getItemName() const {
+			return itemName;
+		}
+		int getItemQuantity() const {
+			return itemQuantity;
+		}
+		Money getItemPrice() const {
+			return itemPrice;
+		}
+		CategoryTag getCategoryTag() const {
+			return itemCategory;
+		}
+};
+
+// Item of one registry category, the registry names each one, such as ClothingItem
+template <CategoryTag Tag>
+class CategoryItem : public Item {
+	public:
+		CategoryItem(const string& id, const string& name, int quantity, Money price)
+			: Item(Tag, id, name, quantity, price) {}
+
+		const char* getItemCategory() const override {
+			return categoryTable[static_cast<size_t>(Tag)].name;
+		}
+};
+
+#define INVENTORY_CATEGORY_ITEM(tag, code, name) using tag##Item = CategoryItem<CategoryTag::tag>;
+INVENTORY_CATEGORIES(INVENTORY_CATEGORY_ITEM)
+#undef INVENTORY_CATEGORY_ITEM
+
+// Slab allocator for one item type, removed items leave their slot on a free list for the next add
+template <typename T>
+class ItemPool {
+	private:
+		union Slot {
+			Slot* next;
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+
+		static const size_t slotsPerSlab = 1024;
+		vector<unique_ptr<Slot[]>> slabs;
+		size_t usedInLastSlab = slotsPerSlab; // Slots handed out from the newest slab
+		Slot* freeList = nullptr;
+		size_t liveCount = 0;
+
+	public:
+		ItemPool() = default;
+		ItemPool(const ItemPool&) = delete;
+		ItemPool& operator=(const ItemPool&) = delete;
+
+		template <typename... Args>
+		T* create(Args&&... args) {
+			Slot* slot;
+			if (freeList != nullptr) {
+				slot = freeList;
+				freeList = freeList->next;
+			} else {
+				if (usedInLastSlab == slotsPerSlab) {
+					slabs.emplace_back(new Slot[slotsPerSlab]);
+					usedInLastSlab = 0;
+				}
+				slot = &slabs.back()[usedInLastSlab++];
+			}
+
+			try {
+				T* object = new (slot->storage) T(forward<Args>(args)...);
+				liveCount++;
+				return object;
+			} catch (...) {
+				slot->next = freeList; // Give the slot back if construction fails
+				freeList = slot;
+				throw;
+			}
+		}
+
+		void destroy(T* object) {
+			object->~T();
+			Slot* slot = reinterpret_cast<Slot*>(object);
+			slot->next = freeList;
+			freeList = slot;
+			liveCount--;
+		}
+
+		// Frees every slab at once, live objects must already be destroyed
+		void releaseAll() {
+			slabs.clear();
+			usedInLastSlab = slotsPerSlab;
+			freeList = nullptr;
+			liveCount = 0;
+		}
+
+		size_t size() const {
+			return liveCount;
+		}
+		size_t slabCount() const {
+			return slabs.size();
+		}
+};
+
+// One pool per registry category, creation and destruction index tables built from the tags
+class CategoryPools {
+	private:
+		template <size_t... Tag>
+		static tuple<ItemPool<CategoryItem<static_cast<CategoryTag>(Tag)>>...> makePools(index_sequence<Tag...>);
+		using Tags = make_index_sequence<categoryCount>;
+		using Pools = decltype(makePools(Tags()));
+		using Factory = Item* (*)(Pools&, const string&, const string&, int, Money);
+		using Destroyer = void (*)(Pools&, Item*);
+
+		Pools pools;
+
+		template <size_t Tag>
+		static Item* createIn(Pools& pools, const string& id, const string& name, int quantity, Money price) {
+			return get<Tag>(pools).create(id, name, quantity, price);
+		}
+		template <size_t Tag>
+		static void destroyIn(Pools& pools, Item* item) {
+			get<Tag>(pools).destroy(static_cast<CategoryItem<static_cast<CategoryTag>(Tag)>*>(item));
+		}
+
+		template <size_t... Tag>
+		static const Factory* factories(index_sequence<Tag...>) {
+			static constexpr Factory table[] = {&createIn<Tag>...};
+			return table;
+		}
+		template <size_t... Tag>
+		static const Destroyer* destroyers(index_sequence<Tag...>) {
+			static constexpr Destroyer table[] = {&destroyIn<Tag>...};
+			return table;
+		}
+		template <size_t... Tag>
+		static const size_t* sizes(index_sequence<Tag...>) {
+			static constexpr size_t table[] = {sizeof(CategoryItem<static_cast<CategoryTag>(Tag)>)...};
+			return table;
+		}
+		template <size_t... Tag>
+		void releaseAll(index_sequence<Tag...>) {
+			(get<Tag>(pools).releaseAll(), ...);
+		}
+
+	public:
+		// Bytes of one item of the category, excluding the strings' heap buffers
+		static size_t itemSize(CategoryTag tag) {
+			return sizes(Tags())[static_cast<size_t>(tag)];
+		}
+
+		Item* create(CategoryTag tag, const string& id, const string& name, int quantity, Money price) {
+			return factories(Tags())[static_cast<size_t>(tag)](pools, id, name, quantity, price);
+		}
+		void destroy(Item* item) {
+			destroyers(Tags())[static_cast<size_t>(item->getCategoryTag())](pools, item);
+		}
+		// Frees every slab of every pool, live items must already be destroyed
+		void releaseAll() {
+			releaseAll(Tags());
+		}
+};
+
+// Running totals of one category, updated on every add, update and remove
+struct CategoryStats {
+	size_t itemCount = 0;
+	long long totalQuantity = 0;
+	MoneyTotal totalValue; // Sum of quantity * price
+};
+
+// Aggregates of one category or of the whole inventory, computed by a full scan of the columns
+struct ValuationTotals {
+	size_t itemCount = 0;
+	long long totalQuantity = 0;
+	MoneyTotal totalValue; // Sum of quantity * price
+	Money priceSum;
+	Money minPrice; // Zero when there are no items
+	Money maxPrice;
+	Money averagePrice() const { // Rounded to the nearest cent
+		if (itemCount == 0) {
+			return Money();
+		}
+		long long count = static_cast<long long>(itemCount), sum = priceSum.getCents();
+		return Money::fromCents((sum >= 0 ? sum + count / 2 : sum - count / 2) / count);
+	}
+};
+
+struct InventoryValuation {
+	ValuationTotals categories[categoryCount]; // In tag order
+	ValuationTotals overall;
+};
+
+// Mutations recorded in the operation log
+enum class LogOperation : uint8_t { Add = 1, SetQuantity, SetPrice, Remove, SetReorderLevel, SetCategoryReorderLevel };
+
+// Fields the inventory can be sorted by, Value is the stock value quantity * price
+enum class SortField { Quantity, Price, Name, ID, Category, Value };
+
+struct SortKey {
+	SortField field;
+	bool ascending;
+};
+
+// One condition of an item query, every comparison is kept as an inclusive range so the planner can intersect them
+struct QueryCondition {
+	SortField field;
+	bool negated = false; // != keeps the items outside the range
+	long long low = numeric_limits<long long>::min(); // Quantity, price in cents or category tag
+	long long high = numeric_limits<long long>::max();
+	string text; // Lowercase ID or name
+};
+
+// Parsed form of a query such as "category=el AND price<100 AND quantity BETWEEN 1 AND 10 ORDER BY price DESC LIMIT 20"
+struct ItemQuery {
+	vector<QueryCondition> conditions; // Every condition must hold
+	vector<SortKey> order;
+	size_t limit = numeric_limits<size_t>::max();
+	bool useIndexes = true; // False always scans the columns, for benchmarks
+};
+
+// Where the planner took the candidates of a query from
+enum class QueryAccess { IDLookup, CategoryBucket, PriceRange, QuantityRange, PriceOrder, QuantityOrder, NameOrder, Scan };
+
+struct QueryResult {
+	vector<Item*> items;
+	QueryAccess access = QueryAccess::Scan;
+	size_t examined = 0; // Candidates checked against the conditions
+};
+
+class OperationLog;
+
+struct CsvImportResult {
+	size_t imported = 0;
+	size_t rejected = 0;
+	uint64_t bytes = 0;
+	double seconds = 0;
+	vector<string> errors; // First few rejected lines
+	string failure; // Set when the file could not be read at all
+	string saveError; // Set when the imported items could not be saved as a snapshot
+};
+
+// Contiguous storage for one string column, rows refer to entries in a shared pool
+class StringColumn {
+	private:
+		struct Entry {
+			uint64_t offset;
+			uint32_t length;
+			uint32_t references;
+		};
+
+		// Hashing looks through the entry into the pool so interned strings are found by content
+		struct EntryHash {
+			const StringColumn* column;
+			size_t operator()(uint32_t entry) const {
+				return hash<string_view>()(column->entryText(entry));
+			}
+		};
+		struct EntryEqual {
+			const StringColumn* column;
+			bool operator()(uint32_t a, uint32_t b) const {
+				return column->entryText(a) == column->entryText(b);
+			}
+		};
+
+		bool internStrings; // Equal strings share one entry, pointless for unique columns such as IDs
+		string pool;
+		vector<Entry> entries;
+		vector<uint32_t> freeEntries;
+		vector<uint32_t> rows;
+		unordered_set<uint32_t, EntryHash, EntryEqual> interned;
+		uint64_t deadBytes = 0;
+
+		string_view entryText(uint32_t entry) const {
+			return string_view(pool.data() + entries[entry].offset, entries[entry].length);
+		}
+		uint32_t intern(string_view text);
+		void release(uint32_t entry);
+		void compact();
+
+	public:
+		explicit StringColumn(bool intern) : internStrings(intern), interned(16, EntryHash{this}, EntryEqual{this}) {}
+		StringColumn(const StringColumn&) = delete; // The hash functors point at this column
+		StringColumn& operator=(const StringColumn&) = delete;
+
+		size_t size() const {
+			return rows.size();
+		}
+		string_view operator[](size_t row) const {
+			return entryText(rows[row]);
+		}
+		void push_back(string_view text) {
+			rows.push_back(intern(text));
+		}
+		void set(size_t row, string_view text) {
+			uint32_t entry = intern(text);
+			release(rows[row]);
+			rows[row] = entry;
+		}
+		// Row moves for swap-and-pop and bulk compaction, a released row must be overwritten or truncated
+		void releaseRow(size_t row) {
+			release(rows[row]);
+		}
+		void moveRow(size_t from, size_t to) {
+			rows[to] = rows[from];
+		}
+		void truncate(size_t rowCount) {
+			rows.resize(rowCount);
+		}
+		void reserve(size_t rowCount) {
+			rows.reserve(rowCount);
+			if (internStrings) {
+				interned.reserve(rowCount);
+			}
+		}
+		void clear();
+};
+
+void toLowerCase(string& str);
+
+// Stable reference to a stored item, a removed item's handle stops resolving even if its slot is reused
+struct ItemHandle {
+	uint32_t slot;
+	uint32_t generation;
+};
+
+// Reader-writer lock split into shards, a reader locks only its own thread's shard so readers never contend on one counter
+// A writer takes every shard in order
+class ShardedSharedMutex {
+	private:
+		static const size_t shardCount = 16;
+		struct alignas(64) Shard {
+			shared_mutex mutex;
+		};
+		Shard shards[shardCount];
+
+		static size_t threadShard() {
+			static atomic<size_t> nextShard{0};
+			static thread_local size_t shard = nextShard++ % shardCount; // Threads are dealt out round robin
+			return shard;
+		}
+
+	public:
+		void lock() {
+			for (Shard& shard : shards) {
+				shard.mutex.lock();
+			}
+		}
+		void unlock() {
+			for (size_t i = shardCount; i-- > 0;) {
+				shards[i].mutex.unlock();
+			}
+		}
+		void lock_shared() {
+			shards[threadShard()].mutex.lock_shared();
+		}
+		void unlock_shared() {
+			shards[threadShard()].mutex.unlock_shared();
+		}
+};
+
+// Copy of one item, safe to keep after the lock is released
+struct ItemRecord {
+	string id;
+	string name;
+	int quantity;
+	Money price;
+	CategoryTag category;
+};
+
+// QueryResult with copies of the items, from queryRecords
+struct RecordQueryResult {
+	vector<ItemRecord> items;
+	QueryAccess access = QueryAccess::Scan;
+	size_t examined = 0;
+};
+
+// Keeps the first limit rows in the order of the keys, rows equal on every key stay in row order like a stable sort
+// A bounded max-heap, so picking k of n rows is O(n log k), and heaps kept by several threads merge into one
+// A quantity, price or value first key is read from the columns, so most rows are turned away without touching their item
+class TopRows {
+	private:
+		struct Entry {
+			long long key; // First key when it is a number, otherwise 0
+			uint32_t row;
+		};
+		Item* const* items;
+		const int* quantities;
+		const Money* prices;
+		SortKey firstKey;
+		bool numericFirst;
+		vector<SortKey> tieKeys; // Compared through the items when the first key ties or is not a number
+		size_t limit;
+		vector<Entry> heap; // The front is the last of the kept rows
+
+		long long keyOf(uint32_t row) const;
+		bool before(const Entry& a, const Entry& b) const;
+		void offer(const Entry& entry);
+
+	public:
+		TopRows(Item* const* rowItems, const int* quantityColumn, const Money* priceColumn, const vector<SortKey>& keys, size_t count);
+		void offer(uint32_t row) {
+			offer(Entry{keyOf(row), row});
+		}
+		void merge(const TopRows& other);
+		vector<uint32_t> rows() const; // In order
+};
+
+// Class Manager
+class Inventory {
+	friend class OperationLog; // Replays records through the private mutators
+
+	private:
+		vector<Item*> itemStorage; // Store pointers (all 3 categories of items) to Item Base Class
+		unordered_map<string, uint32_t> itemIndex; // Lowercase ID to slot, kept in sync by add and remove
+
+		// Slots give every item a stable handle while rows move on removal
+		struct ItemSlot {
+			uint32_t row;
+			uint32_t generation;
+			uint32_t bucketPosition; // Index within its category bucket
+			int32_t reorderLevel; // useCategoryReorderLevel unless set for this item
+			uint32_t lowStockPosition; // Index within lowStockSlots, or notLowStock
+			uint32_t nameSerial; // Serial of the item's name postings
+			// The item's entries in the ordered views, so changes never search among equal keys
+			multimap<Money, Item*>::iterator priceEntry{};
+			multimap<int, Item*>::iterator quantityEntry{};
+			multimap<string, Item*>::iterator nameEntry{};
+		};
+		vector<ItemSlot> slots;
+		vector<uint32_t> freeSlots;
+		vector<uint32_t> rowSlots; // Slot of each storage row
+
+		// Slots of each category's items, so a category listing walks only its own items
+		struct CategoryBucket {
+			vector<uint32_t> slots;
+			CategoryStats stats;
+		};
+		CategoryBucket buckets[categoryCount];
+
+		// Items at or below their reorder level, kept current on every quantity change so the report is O(low items)
+		static const uint32_t notLowStock = numeric_limits<uint32_t>::max();
+		vector<uint32_t> lowStockSlots;
+		int categoryReorderLevels[categoryCount];
+		function<void(const Item*, int, bool)> lowStockCallback;
+
+		// Column store, row i of every column describes itemStorage[i] so scans never touch the items
+		vector<int> quantityColumn;
+		vector<Money> priceColumn;
+		vector<CategoryTag> categoryColumn;
+		StringColumn idColumn{false};
+		StringColumn nameColumn{true};
+
+		// Items are allocated from one pool per category
+		CategoryPools itemPools;
+
+		// Ordered views, kept in sync on add, update and remove so sorting never reorders itemStorage
+		multimap<Money, Item*> priceView;
+		multimap<int, Item*> quantityView;
+		multimap<string, Item*> nameView;
+
+		// Trigram of a lowercase name to the items whose names contain it, for substring search
+		// Every add takes the next serial, so appending keeps each list sorted and lists intersect by merging
+		// Removed items are left behind and skipped by serial, a list is compacted once half of it is stale
+		struct Posting {
+			uint32_t serial;
+			uint32_t slot;
+		};
+		struct PostingList {
+			vector<Posting> postings;
+			uint32_t stale = 0;
+		};
+		unordered_map<uint32_t, PostingList> trigramIndex;
+		uint32_t nextNameSerial = 0;
+		static const uint32_t retiredNameSerial = numeric_limits<uint32_t>::max(); // Never handed out
+
+		// Live quantity of each slot, changed by compare-and-swap while the lock is only shared
+		// An adjusted slot is pushed once onto a lock-free stack, the next exclusive holder folds it into the columns, views and log
+		struct LiveQuantity {
+			atomic<int> quantity{0};
+			atomic<bool> pending{false};
+			uint32_t nextPending = 0;
+		};
+		static const uint32_t noPendingSlot = numeric_limits<uint32_t>::max();
+		deque<LiveQuantity> liveQuantities; // Never relocates, so a shared holder may keep a reference
+		atomic<uint32_t> pendingAdjustments{noPendingSlot};
+
+		Item* findItem(const string& id) const;
+		size_t findRow(const string& id) const;
+		int reorderLevelAt(size_t row) const;
+		static vector<ItemRecord> copyRecords(const vector<Item*>& items);
+		void moveRow(size_t from, size_t to);
+		void truncateRows(size_t rowCount);
+		void unindexItem(Item* item, size_t row);
+		void storeItem(Item* item, bool logged = true);
+		void unstoreItem(Item* item);
+		size_t removeRows(const vector<char>& removeRow);
+		void reserveItems(size_t additional);
+		size_t removeIds(const vector<string>& ids, vector<string>& missing);
+		bool runBatchCommand(const vector<string_view>& tokens, string& report);
+		void setItemQuantity(Item* item, int newQuantity);
+		void setItemPrice(Item* item, Money newPrice);
+		void setItemReorderLevel(Item* item, int reorderLevel);
+		void refreshLowStock(uint32_t slot, size_t row);
+		vector<uint32_t> lowStockRows() const;
+		static void nameTrigrams(const string& name, vector<uint32_t>& trigrams);
+		void indexName(uint32_t slot, const string& name);
+		void unindexName(const string& name);
+		void rebuildNameIndex();
+		bool adjustLiveQuantity(uint32_t slot, int delta, bool floorAtZero, int* newQuantity);
+		void applyPendingAdjustments();
+		struct NameMatch {
+			Item* item;
+			string_view name;
+			int rank;
+		};
+		static void rankNameMatches(vector<NameMatch>& matches, size_t limit);
+		void logMutation(LogOperation operation, const Item* item);
+		void logReorderLevel(LogOperation operation, CategoryTag tag, string_view id, int reorderLevel);
+		template <typename Key>
+		static vector<Item*> viewItems(const multimap<Key, Item*>& view, bool ascending, size_t limit);
+		template <typename Key>
+		static vector<Item*> viewRange(const multimap<Key, Item*>& view, const Key& min, const Key& max);
+		template <typename Key>
+		static bool boundedViewRange(const multimap<Key, Item*>& view, const Key& min, const Key& max, size_t budget, vector<Item*>& result);
+		template <typename Key>
+		bool orderedViewWalk(const multimap<Key, Item*>& view, bool ascending, const ItemQuery& query, size_t budget, QueryResult& result) const;
+		bool itemMatches(const Item* item, const vector<QueryCondition>& conditions) const;
+		void scanRows(const ItemQuery& query, size_t begin, size_t end, bool stopAtLimit, vector<Item*>* matches, TopRows* top, size_t& examined) const;
+		vector<uint32_t> topRows(const ItemQuery& query, const vector<SortKey>& keys, size_t& examined) const;
+		bool scanQuery(const ItemQuery& query, const vector<SortKey>& order, QueryResult& result) const;
+
+		static const size_t parallelSortThreshold = 100000; // Below this a single thread sorts faster
+		static const size_t parallelValuationThreshold = 1 << 18; // Rows below which one thread scans faster than several
+		static const size_t indexCandidateCost = 64; // Scanned rows that cost about as much as one candidate from an index
+
+		OperationLog* operationLog = nullptr; // Receives every mutation once attached
+		string snapshotPath;
+
+		// Guards the core API, import and batch mode
+		mutable ShardedSharedMutex inventoryMutex;
+
+#if INVENTORY_METRICS
+		mutable OperationMetrics metrics; // Counts and times the public operations
+#endif
+		uint64_t categoryMemory(CategoryTag tag) const;
+
+	public:
+		static bool isValidID(string_view id);
+		bool isIDTaken(const string& fullID);
+		static bool validateChar(char input); // Forward declaration
+		static bool validateString(const string &input);
+		static string capitalizeFirstLetter(const string& input);
+		static bool validateInt(int input);
+		static bool isString(const string& input);
+		static bool isAllDigits(string_view input);
+
+		// Pointer queries return the stored items, the pointers stay valid until the item is removed
+		// They take no lock, so they are for a single thread such as the console, other threads use the record queries below
+		const Item* getItem(const string& id) const;
+		const vector<Item*>& items() const {
+			return itemStorage; // Storage order
+		}
+		// Every row in storage order straight from the columns, for full listings that would chase each item pointer
+		// The visitor takes the ID, name, quantity, price and category tag of a row and returns false to stop
+		template <typename Visitor>
+		void visitRows(Visitor visit) const {
+			shared_lock<ShardedSharedMutex> lock(inventoryMutex);
+			for (size_t row = 0; row < categoryColumn.size(); row++) {
+				if (!visit(idColumn[row], nameColumn[row], quantityColumn[row], priceColumn[row], categoryColumn[row])) {
+					return;
+				}
+			}
+		}
+		vector<Item*> itemsInCategory(CategoryTag tag) const;
+		vector<Item*> sortedItems(const vector<SortKey>& keys, size_t limit = numeric_limits<size_t>::max()) const; // The first limit items of the full order
+		vector<Item*> itemsInPriceRange(Money minPrice, Money maxPrice) const;
+		vector<Item*> itemsInQuantityRange(int minQuantity, int maxQuantity) const;
+		static bool parseSortField(char letter, SortField* field = nullptr);
+		static bool compareItems(const Item* a, const Item* b, const vector<SortKey>& keys);
+		static int compareItemKeys(const Item* a, const Item* b, const vector<SortKey>& keys); // Negative when a goes first, 0 when equal
+
+		// Filtered, ordered and limited listings, the planner picks the ID hash, a category bucket or an ordered view
+		// when one narrows the candidates enough and scans the columns otherwise
+		// Items that tie on the ORDER BY keys are ordered by ID, so every plan returns the same items
+		static bool parseQuery(string_view text, ItemQuery& query, string& error);
+		QueryResult runQuery(const ItemQuery& query) const;
+		static const char* getQueryAccessName(QueryAccess access);
+
+		// Name search, case-insensitive
+		static const size_t nameSearchLimit = 50;
+		vector<Item*> namesWithPrefix(string_view prefix, size_t limit) const;
+		vector<Item*> searchNames(string_view text, size_t limit, size_t* matchCount = nullptr) const;
+
+		// Reorder levels and the low-stock index
+		static const int defaultReorderLevel = 5;
+		static const int useCategoryReorderLevel = -1;
+		int getReorderLevel(const Item* item) const;
+		int getCategoryReorderLevel(CategoryTag tag) const {
+			return categoryReorderLevels[static_cast<size_t>(tag)];
+		}
+		void setCategoryReorderLevel(CategoryTag tag, int reorderLevel);
+		vector<Item*> lowStockItems() const;
+		size_t lowStockCount() const {
+			return lowStockSlots.size();
+		}
+		// Called with the item, its reorder level and true when it drops to the level, false when it is restocked above it
+		void setLowStockCallback(function<void(const Item*, int, bool)> callback) {
+			lowStockCallback = move(callback);
+		}
+
+		// Thread-safe core API without console I/O, lookups share the lock and changes take it exclusively
+		// IDs are full IDs in any case, changes are durable once commitChanges returns true
+		bool lookupItem(const string& id, ItemRecord& record) const;
+		bool lookupReorderLevel(const string& id, int& reorderLevel) const;
+		bool insertItem(CategoryTag tag, const string& id, const string& name, int quantity, Money price);
+		bool updateQuantity(const string& id, int quantity);
+		bool updatePrice(const string& id, Money price);
+		bool updateReorderLevel(const string& id, int reorderLevel); // useCategoryReorderLevel to follow the category again
+		bool eraseItem(const string& id);
+		size_t itemCount() const;
+		bool commitChanges(string& error); // False when the log could not be written, the changes stay pending
+
+		// Record queries copy the result of the pointer query of the same name under the shared lock
+		// The quantities are the ones the query saw, stock adjustments that were not folded in yet are left out
+		vector<ItemRecord> recordsInCategory(CategoryTag tag) const;
+		vector<ItemRecord> lowStockRecords() const;
+		RecordQueryResult queryRecords(const ItemQuery& query) const; // The lock is held from planning to the last copy
+		vector<ItemRecord> nameRecordsWithPrefix(string_view prefix, size_t limit) const;
+		vector<ItemRecord> searchNameRecords(string_view text, size_t limit, size_t* matchCount = nullptr) const;
+		vector<ItemRecord> sortedRecords(const vector<SortKey>& keys, size_t limit = numeric_limits<size_t>::max()) const;
+
+		// Stock adjustments that only share the lock, many threads may adjust the same item at once
+		// adjustQuantity applies any delta that keeps the quantity within int, tryAdjustQuantity also refuses to go below zero
+		// The ordered views, totals, low-stock set and log catch up at the next exclusive operation or commitChanges
+		bool adjustQuantity(const string& id, int delta, int* newQuantity = nullptr);
+		bool tryAdjustQuantity(const string& id, int delta, int* newQuantity = nullptr);
+		bool adjustQuantity(ItemHandle handle, int delta, int* newQuantity = nullptr);
+		bool tryAdjustQuantity(ItemHandle handle, int delta, int* newQuantity = nullptr);
+		bool verifyIndexes(string& error) const;
+
+		// Stock value, quantity and price spread of every category, spread over the cores for large inventories
+		// Stock adjustments that were not folded in yet are left out, like in the category totals
+		InventoryValuation valuation() const;
+		// The same scan over any columns with item prices, up to maxPriceCents, threadCount 0 uses every core
+		static InventoryValuation valuateColumns(const int* quantities, const Money* prices, const CategoryTag* categories, size_t rowCount, size_t threadCount = 0);
+
+		// Call counts and latencies of every operation so far, with the item count and memory of each category
+		MetricsReport metricsReport() const;
+
+		// Handles and bulk removal
+		ItemHandle findHandle(const string& id) const;
+		Item* resolve(ItemHandle handle) const;
+		size_t removeItems(const vector<string>& ids); // IDs that are not found are skipped
+		size_t removeItems(const function<bool(const Item*)>& predicate); // Sees the quantities with pending adjustments applied
+		static string getCategory(const Item* item);
+		static CategoryTag getCategoryTag(const Item* item);
+		static const char* getCategoryName(CategoryTag tag);
+		const CategoryStats& getCategoryStats(CategoryTag tag) const {
+			return buckets[static_cast<size_t>(tag)].stats;
+		}
+		static bool parseCategoryCode(string_view code, CategoryTag& tag);
+		static const char* getCategoryCode(CategoryTag tag);
+		Item* createItem(CategoryTag tag, const string& id, const string& name, int quantity, Money price);
+		void destroyItem(Item* item);
+
+		// Persistence, saveSnapshot returns true only once the file and its directory entry are synced to disk
+		bool saveSnapshot(const string& path, string& error) const;
+		bool loadSnapshot(const string& path, string& error);
+		void clear();
+		void attachLog(OperationLog* log, const string& snapshotFile);
+		bool syncLog(string& error);
+
+		// Batch mode
+		size_t runBatch(string_view commands, string& report);
+
+		// CSV bulk import and export
+		size_t csvChunkSize = 64 << 20; // Bytes of the file parsed at once, spread over the cores
+		CsvImportResult importCsv(const string& path);
+		bool exportCsv(const string& path, double& megabytesPerSecond, string& error) const;
+
+		Inventory() {
+			for (int& reorderLevel : categoryReorderLevels) {
+				reorderLevel = defaultReorderLevel;
+			}
+		}
+
+		~Inventory() {
+			clear(); // Destructor to clean allocated memory
+		}
+};
+
+// Append-only log of mutations, applied on top of the last snapshot at startup
+class OperationLog {
+	private:
+		// Fixed part of a record, followed by the ID and name bytes
+		struct RecordHeader {
+			uint32_t checksum; // Covers the rest of the record, a mismatch marks a torn tail
+			uint8_t operation;
+			uint8_t category;
+			uint16_t idLength;
+			uint16_t nameLength;
+			uint16_t flags;
+			int32_t quantity;
+			int64_t price; // Cents, or a double in records without centPrices
+		};
+		static_assert(sizeof(RecordHeader) == 24, "Log record header must stay 24 bytes");
+		static const uint16_t centPrices = 1; // Set in every record written since prices became Money
+
+		FILE* file = nullptr;
+		string logPath;
+		string pending; // Records waiting for the next group commit, kept until a commit reaches the disk
+		size_t pendingRecords = 0;
+		uint64_t logSize = 0; // Bytes known to be on disk
+		string commitError; // Why the last commit failed, empty after a good one
+
+		bool openFile(const char* mode);
+		void appendRecord(RecordHeader& header, string_view id, string_view name);
+
+	public:
+		size_t groupCommitRecords = 1024; // Records per fsync when mutations arrive in bulk
+		uint64_t compactionThreshold = 64ULL << 20; // Log size that triggers a new snapshot
+
+		bool open(const string& path, string& error);
+		void append(LogOperation operation, const Item* item, CategoryTag category);
+		void appendReorderLevel(LogOperation operation, CategoryTag category, string_view id, int reorderLevel); // Empty id for a category level
+		bool commit(); // On failure the records stay pending and lastError says why
+		const string& lastError() const {
+			return commitError;
+		}
+		bool replay(Inventory& inventory, string& error);
+		bool reset();
+		bool needsCompaction() const {
+			return logSize + pending.size() >= compactionThreshold;
+		}
+
+		~OperationLog() {
+			commit(); // Last attempt, callers that must know commit before
+			if (file != nullptr) {
+				fclose(file);
+			}
+		}
+};
+
+// Whole numbers without a sign, as batch commands and command-line options take them
+template <typename Number>
+bool parseNumber(string_view text, Number& value) {
+	if (text.empty() || text[0] == '-' || text[0] == '+') {
+		return false;
+	}
+	auto result = from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+#endif
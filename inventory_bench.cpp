@@ -0,0 +1,1721 @@
+// Benchmarks of every inventory operation on synthetic data, plus the multi-threaded stress test
+#include "inventory.h"
+#include "inventory_console.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+// Every allocation in the process is counted here so a benchmark can report allocations per operation
+// All forms of new and delete are replaced, so each block is freed by the same allocator that made it
+static atomic<uint64_t> allocationCount{0};
+
+static void* countedAllocate(size_t size, size_t alignment) noexcept {
+	allocationCount.fetch_add(1, memory_order_relaxed);
+	size = size != 0 ? size : 1;
+	if (alignment <= alignof(max_align_t)) {
+		return malloc(size);
+	}
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+// GCC inlines the replaced delete into callers and then takes this free for a mismatch with operator new
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static void countedRelease(void* memory, size_t alignment) noexcept {
+#ifdef _WIN32
+	if (alignment > alignof(max_align_t)) {
+		_aligned_free(memory);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	free(memory);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void* operator new(size_t size) {
+	if (void* memory = countedAllocate(size, 0)) {
+		return memory;
+	}
+	throw bad_alloc();
+}
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	return countedAllocate(size, 0);
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return countedAllocate(size, 0);
+}
+void* operator new(size_t size, align_val_t alignment) {
+	if (void* memory = countedAllocate(size, static_cast<size_t>(alignment))) {
+		return memory;
+	}
+	throw bad_alloc();
+}
+void* operator new[](size_t size, align_val_t alignment) {
+	return operator new(size, alignment);
+}
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return countedAllocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return countedAllocate(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* memory) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete[](void* memory) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete(void* memory, size_t) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete[](void* memory, size_t) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete(void* memory, const nothrow_t&) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete[](void* memory, const nothrow_t&) noexcept {
+	countedRelease(memory, 0);
+}
+void operator delete(void* memory, align_val_t alignment) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+void operator delete[](void* memory, align_val_t alignment) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+void operator delete(void* memory, size_t, align_val_t alignment) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+void operator delete[](void* memory, size_t, align_val_t alignment) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+void operator delete(void* memory, align_val_t alignment, const nothrow_t&) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+void operator delete[](void* memory, align_val_t alignment, const nothrow_t&) noexcept {
+	countedRelease(memory, static_cast<size_t>(alignment));
+}
+
+// Synthetic items spread evenly over the categories, the same seed always gives the same items
+vector<ItemRecord> generateItems(size_t count, unsigned seed) {
+	static const char* adjectives[] = {"Blue", "Red", "Classic", "Wireless", "Portable", "Deluxe", "Vintage", "Compact"};
+	static const char* nouns[] = {"Shirt", "Jacket", "Headphones", "Speaker", "Console", "Board Game", "Novel", "Charger"};
+	mt19937 random(seed);
+	vector<ItemRecord> items(count);
+	for (size_t i = 0; i < count; i++) {
+		ItemRecord& item = items[i];
+		item.category = categoryTable[i % categoryCount].tag;
+		item.id = string(categoryTable[i % categoryCount].code) + "b" + to_string(i);
+		item.name = string(adjectives[random() % 8]) + " " + nouns[random() % 8] + " " + to_string(i);
+		item.quantity = static_cast<int>(random() % 200); // About 3% start at or below the default reorder level
+		item.price = Money::fromCents(50 + random() % 99950);
+	}
+	return items;
+}
+
+void fillInventory(Inventory& inventory, const vector<ItemRecord>& items) {
+	for (const ItemRecord& item : items) {
+		inventory.insertItem(item.category, item.id, item.name, item.quantity, item.price);
+	}
+}
+
+// Sort of the original program, the baseline sort_quantity is compared against
+void bubbleSortByQuantity(vector<const Item*>& items) {
+	for (size_t pass = 0; pass + 1 < items.size(); pass++) {
+		bool swapped = false;
+		for (size_t i = 0; i + 1 < items.size() - pass; i++) {
+			if (items[i]->getItemQuantity() > items[i + 1]->getItemQuantity()) {
+				swap(items[i], items[i + 1]);
+				swapped = true;
+			}
+		}
+		if (!swapped) {
+			break;
+		}
+	}
+}
+
+// Totals read through the item pointers, the layout before the column store
+InventoryValuation pointerValuation(const vector<Item*>& items) {
+	InventoryValuation valuation;
+	for (const Item* item : items) {
+		ValuationTotals& totals = valuation.categories[static_cast<size_t>(Inventory::getCategoryTag(item))];
+		Money price = item->getItemPrice();
+		if (totals.itemCount == 0 || price < totals.minPrice) {
+			totals.minPrice = price;
+		}
+		if (totals.itemCount == 0 || price > totals.maxPrice) {
+			totals.maxPrice = price;
+		}
+		totals.itemCount++;
+		totals.totalQuantity += item->getItemQuantity();
+		totals.totalValue += price * item->getItemQuantity();
+		totals.priceSum += price;
+	}
+	for (const ValuationTotals& totals : valuation.categories) {
+		if (totals.itemCount == 0) {
+			continue;
+		}
+		ValuationTotals& overall = valuation.overall;
+		overall.minPrice = overall.itemCount == 0 ? totals.minPrice : min(overall.minPrice, totals.minPrice);
+		overall.maxPrice = overall.itemCount == 0 ? totals.maxPrice : max(overall.maxPrice, totals.maxPrice);
+		overall.itemCount += totals.itemCount;
+		overall.totalQuantity += totals.totalQuantity;
+		overall.totalValue += totals.totalValue;
+		overall.priceSum += totals.priceSum;
+	}
+	return valuation;
+}
+
+// Clock and allocation count of one run, a body repeats its operation iterations times and pauses around its own setup
+class BenchState {
+	private:
+		chrono::steady_clock::time_point started;
+		chrono::steady_clock::duration elapsed{};
+		uint64_t allocationsAtStart = 0;
+		uint64_t allocations = 0;
+
+	public:
+		const size_t iterations;
+		size_t itemsProcessed = 0; // Items read or written, for items per second
+
+		explicit BenchState(size_t count) : iterations(count) {}
+
+		void resumeTiming() {
+			allocationsAtStart = allocationCount.load(memory_order_relaxed);
+			started = chrono::steady_clock::now();
+		}
+		void pauseTiming() {
+			elapsed += chrono::steady_clock::now() - started;
+			allocations += allocationCount.load(memory_order_relaxed) - allocationsAtStart;
+		}
+		double seconds() const {
+			return chrono::duration<double>(elapsed).count();
+		}
+		uint64_t allocationTotal() const {
+			return allocations;
+		}
+};
+
+// Shared by the benchmarks of one scale, the inventory holds every generated item
+struct Fixture {
+	vector<ItemRecord> items;
+	vector<uint32_t> order; // Random permutation of the items, so lookups do not follow insertion order
+	Inventory inventory;
+};
+
+struct Benchmark {
+	const char* name;
+	function<void(BenchState&, Fixture&)> body;
+};
+
+struct BenchmarkResult {
+	string name;
+	size_t scale;
+	size_t iterations;
+	double nanosecondsPerOperation;
+	double itemsPerSecond;
+	double allocationsPerOperation;
+};
+
+// Every operation of the engine plus the console listing, benchmarks that change the shared inventory run last
+vector<Benchmark> inventoryBenchmarks() {
+	vector<Benchmark> benchmarks;
+	benchmarks.push_back({"add", [](BenchState& state, Fixture& fixture) {
+		// Fills fresh inventories, so every add lands in an inventory of up to scale items
+		state.pauseTiming();
+		auto inventory = make_unique<Inventory>();
+		state.resumeTiming();
+		for (size_t i = 0; i < state.iterations; i++) {
+			size_t index = i % fixture.items.size();
+			if (index == 0 && i > 0) {
+				state.pauseTiming();
+				inventory = make_unique<Inventory>();
+				state.resumeTiming();
+			}
+			const ItemRecord& item = fixture.items[index];
+			inventory->insertItem(item.category, item.id, item.name, item.quantity, item.price);
+		}
+		state.itemsProcessed = state.iterations;
+		state.pauseTiming();
+		inventory.reset();
+		state.resumeTiming();
+	}});
+	benchmarks.push_back({"lookup_id", [](BenchState& state, Fixture& fixture) {
+		ItemRecord record;
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.lookupItem(fixture.items[fixture.order[i % fixture.order.size()]].id, record);
+		}
+		state.itemsProcessed = state.iterations;
+	}});
+	benchmarks.push_back({"search_name", [](BenchState& state, Fixture& fixture) {
+		static const char* queries[] = {"shirt", "wireless", "game 1", "vin", "deluxe charger"};
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.searchNames(queries[i % 5], Inventory::nameSearchLimit).size();
+		}
+	}});
+	benchmarks.push_back({"search_name_naive", [](BenchState& state, Fixture& fixture) {
+		// The same queries as search_name by lowercasing every name, the baseline of the trigram index
+		// Every name is scanned, as search_name also finds every match before it keeps the best nameSearchLimit
+		static const char* queries[] = {"shirt", "wireless", "game 1", "vin", "deluxe charger"};
+		string lowered;
+		for (size_t i = 0; i < state.iterations; i++) {
+			string_view query = queries[i % 5];
+			size_t matches = 0;
+			for (const Item* item : fixture.inventory.items()) {
+				const string& name = item->getItemName();
+				lowered.resize(name.size());
+				transform(name.begin(), name.end(), lowered.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+				if (lowered.find(query) != string::npos) {
+					matches++;
+				}
+			}
+			state.itemsProcessed += matches < Inventory::nameSearchLimit ? matches : Inventory::nameSearchLimit;
+		}
+	}});
+	benchmarks.push_back({"price_range", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.itemsInPriceRange(Money::fromCents(10000), Money::fromCents(11000)).size();
+		}
+	}});
+	benchmarks.push_back({"category_listing", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.itemsInCategory(categoryTable[i % categoryCount].tag).size();
+		}
+	}});
+	benchmarks.push_back({"category_scan", [](BenchState& state, Fixture& fixture) {
+		// Category of every item, the dispatch a full listing or export pays per row
+		for (size_t i = 0; i < state.iterations; i++) {
+			size_t counts[categoryCount] = {};
+			for (const Item* item : fixture.inventory.items()) {
+				counts[static_cast<size_t>(Inventory::getCategoryTag(item))]++;
+			}
+			for (size_t count : counts) {
+				state.itemsProcessed += count;
+			}
+		}
+	}});
+	benchmarks.push_back({"low_stock", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.lowStockItems().size();
+		}
+	}});
+	benchmarks.push_back({"query_selective", [](BenchState& state, Fixture& fixture) {
+		ItemQuery query;
+		string error;
+		Inventory::parseQuery("category=el AND price<100 AND quantity BETWEEN 1 AND 10", query, error);
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.runQuery(query).items.size();
+		}
+	}});
+	benchmarks.push_back({"query_broad", [](BenchState& state, Fixture& fixture) {
+		ItemQuery query;
+		string error;
+		Inventory::parseQuery("category=cl AND price<500 AND quantity>=10", query, error);
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.runQuery(query).items.size();
+		}
+	}});
+	benchmarks.push_back({"valuation", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.valuation().overall.itemCount;
+		}
+	}});
+	benchmarks.push_back({"valuation_pointers", [](BenchState& state, Fixture& fixture) {
+		// The valuation scan through the item pointers instead of the columns, run with --scale 1000000 for the full comparison
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += pointerValuation(fixture.inventory.items()).overall.itemCount;
+		}
+	}});
+	benchmarks.push_back({"sort_quantity", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.sortedItems({{SortField::Quantity, true}}).size();
+		}
+	}});
+	benchmarks.push_back({"sort_quantity_bubble", [](BenchState& state, Fixture& fixture) {
+		// Bubble sort takes hours at a million items, so larger scales sort only their first bubbleSortLimit items
+		const size_t bubbleSortLimit = 20000;
+		const vector<Item*>& items = fixture.inventory.items();
+		size_t count = min(items.size(), bubbleSortLimit);
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.pauseTiming();
+			vector<const Item*> sorted(items.begin(), items.begin() + count);
+			state.resumeTiming();
+			bubbleSortByQuantity(sorted);
+			state.itemsProcessed += sorted.size();
+		}
+	}});
+	benchmarks.push_back({"sort_price", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.sortedItems({{SortField::Price, false}}).size();
+		}
+	}});
+	benchmarks.push_back({"top_value_100", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.sortedItems({{SortField::Value, false}}, 100).size();
+		}
+	}});
+	benchmarks.push_back({"sort_category_name", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += fixture.inventory.sortedItems({{SortField::Category, true}, {SortField::Name, true}}).size();
+		}
+	}});
+	benchmarks.push_back({"display_all", [](BenchState& state, Fixture& fixture) {
+		// The --list table, written to the null device so only formatting is measured
+#ifdef _WIN32
+		FILE* output = fopen("NUL", "wb");
+#else
+		FILE* output = fopen("/dev/null", "wb");
+#endif
+		if (output == nullptr) {
+			return;
+		}
+		InventoryConsole console(fixture.inventory);
+		for (size_t i = 0; i < state.iterations; i++) {
+			console.listAllItems(output);
+		}
+		state.itemsProcessed = state.iterations * fixture.inventory.itemCount();
+		fclose(output);
+	}});
+	benchmarks.push_back({"display_all_iostream", [](BenchState& state, Fixture& fixture) {
+		// The same table through the setw and endl row code that TableRenderer replaced, the baseline of display_all
+#ifdef _WIN32
+		ofstream output("NUL");
+#else
+		ofstream output("/dev/null");
+#endif
+		if (!output) {
+			return;
+		}
+		for (size_t i = 0; i < state.iterations; i++) {
+			output << "\t" << left << setw(15) << "ID" << setw(15) << "Name" << setw(15) << "Quantity" << setw(15) << "Price" << setw(15) << "Category" << endl;
+			for (const Item* item : fixture.inventory.items()) {
+				const string& name = item->getItemName();
+				output << "\t" << left << setw(15) << item->getItemID();
+				if (name.length() > 18 - 3) {
+					output << name.substr(0, 18 - 3) << "...";
+				} else {
+					output << setw(15) << name;
+				}
+				output << setw(15) << item->getItemQuantity() << setw(15) << fixed << setprecision(2) << item->getItemPrice().getCents() / 100.0
+				       << setw(15) << Inventory::getCategory(item) << endl;
+			}
+		}
+		state.itemsProcessed = state.iterations * fixture.inventory.itemCount();
+	}});
+	benchmarks.push_back({"snapshot_save", [](BenchState& state, Fixture& fixture) {
+		string error;
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.saveSnapshot("inventory_bench.snap", error);
+		}
+		state.itemsProcessed = state.iterations * fixture.inventory.itemCount();
+	}});
+	benchmarks.push_back({"snapshot_load", [](BenchState& state, Fixture& fixture) {
+		// Saves its own snapshot first, so it runs without snapshot_save and only counts loads that succeed
+		string error;
+		state.pauseTiming();
+		bool saved = fixture.inventory.saveSnapshot("inventory_bench.snap", error);
+		state.resumeTiming();
+		if (!saved) {
+			return;
+		}
+		Inventory loaded;
+		for (size_t i = 0; i < state.iterations; i++) {
+			if (loaded.loadSnapshot("inventory_bench.snap", error)) {
+				state.itemsProcessed += loaded.itemCount();
+			}
+		}
+		state.pauseTiming();
+		loaded.clear();
+		state.resumeTiming();
+	}});
+	benchmarks.push_back({"update_quantity", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.updateQuantity(fixture.items[fixture.order[i % fixture.order.size()]].id, static_cast<int>(i % 200));
+		}
+		state.itemsProcessed = state.iterations;
+	}});
+	benchmarks.push_back({"update_price", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.updatePrice(fixture.items[fixture.order[i % fixture.order.size()]].id, Money::fromCents(100 + i % 1000));
+		}
+		state.itemsProcessed = state.iterations;
+	}});
+	benchmarks.push_back({"adjust_quantity", [](BenchState& state, Fixture& fixture) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.tryAdjustQuantity(fixture.items[fixture.order[i % fixture.order.size()]].id, i % 2 == 0 ? 1 : -1);
+		}
+		string error;
+		fixture.inventory.commitChanges(error); // Folding the adjustments in is part of their cost, no log is attached
+		state.itemsProcessed = state.iterations;
+	}});
+	benchmarks.push_back({"logged_update", [](BenchState& state, Fixture& fixture) {
+		// Quantity updates with the operation log attached, one fsync per group of records, the target is 100000 per second
+		OperationLog log;
+		string error;
+		state.pauseTiming();
+		bool opened = log.open("inventory_bench.wal", error);
+		fixture.inventory.attachLog(&log, "inventory_bench.snap");
+		state.resumeTiming();
+		if (!opened) {
+			return;
+		}
+		for (size_t i = 0; i < state.iterations; i++) {
+			fixture.inventory.updateQuantity(fixture.items[fixture.order[i % fixture.order.size()]].id, static_cast<int>(i % 200));
+		}
+		if (fixture.inventory.commitChanges(error)) {
+			state.itemsProcessed = state.iterations;
+		}
+		state.pauseTiming();
+		fixture.inventory.attachLog(nullptr, "");
+		log.reset();
+		state.resumeTiming();
+	}});
+	benchmarks.push_back({"batch_commands", [](BenchState& state, Fixture& fixture) {
+		// Batch text of alternating queries and quantity updates, parsing and reporting included, the target is 1000000 per second
+		state.pauseTiming();
+		string commands;
+		for (size_t i = 0; i < state.iterations; i++) {
+			const string& id = fixture.items[fixture.order[i % fixture.order.size()]].id;
+			commands += i % 2 == 0 ? "query " + id + "\n" : "update " + id + " quantity " + to_string(i % 200) + "\n";
+		}
+		string report;
+		state.resumeTiming();
+		size_t failed = fixture.inventory.runBatch(commands, report);
+		state.itemsProcessed = state.iterations - failed;
+	}});
+	benchmarks.push_back({"remove", [](BenchState& state, Fixture& fixture) {
+		// Empties filled copies in random order, refilling is not timed
+		auto inventory = make_unique<Inventory>();
+		for (size_t i = 0; i < state.iterations; i++) {
+			size_t index = i % fixture.order.size();
+			if (index == 0) {
+				state.pauseTiming();
+				inventory = make_unique<Inventory>();
+				fillInventory(*inventory, fixture.items);
+				state.resumeTiming();
+			}
+			inventory->eraseItem(fixture.items[fixture.order[index]].id);
+		}
+		state.itemsProcessed = state.iterations;
+		state.pauseTiming();
+		inventory.reset();
+		state.resumeTiming();
+	}});
+	benchmarks.push_back({"remove_bulk_10pct", [](BenchState& state, Fixture& fixture) {
+		// One removeItems call by ID list per filled copy, a random tenth of the items
+		state.pauseTiming();
+		vector<string> ids;
+		for (size_t i = 0; i < fixture.order.size(); i += 10) {
+			ids.push_back(fixture.items[fixture.order[i]].id);
+		}
+		state.resumeTiming();
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.pauseTiming();
+			auto inventory = make_unique<Inventory>();
+			fillInventory(*inventory, fixture.items);
+			state.resumeTiming();
+			state.itemsProcessed += inventory->removeItems(ids);
+			state.pauseTiming();
+			inventory.reset();
+			state.resumeTiming();
+		}
+	}});
+	benchmarks.push_back({"remove_bulk_50pct", [](BenchState& state, Fixture& fixture) {
+		// One removeItems call by predicate per filled copy, the items with an even quantity, about half
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.pauseTiming();
+			auto inventory = make_unique<Inventory>();
+			fillInventory(*inventory, fixture.items);
+			state.resumeTiming();
+			state.itemsProcessed += inventory->removeItems([](const Item* item) { return item->getItemQuantity() % 2 == 0; });
+			state.pauseTiming();
+			inventory.reset();
+			state.resumeTiming();
+		}
+	}});
+	return benchmarks;
+}
+
+// Repeats the body with more iterations until one run takes at least minSeconds, like Google Benchmark
+BenchmarkResult runBenchmark(const Benchmark& benchmark, Fixture& fixture, size_t scale, double minSeconds) {
+	const size_t maxIterations = 1000000000;
+	size_t iterations = 1;
+	while (true) {
+		BenchState state(iterations);
+		state.resumeTiming();
+		benchmark.body(state, fixture);
+		state.pauseTiming();
+
+		double seconds = state.seconds();
+		if (seconds >= minSeconds || iterations >= maxIterations) {
+			return {benchmark.name, scale, iterations, seconds * 1e9 / iterations,
+			        seconds > 0 ? state.itemsProcessed / seconds : 0.0, static_cast<double>(state.allocationTotal()) / iterations};
+		}
+		// Aim 40% past the minimum from the rate so far, growing at most tenfold per step
+		double wanted = seconds > 0 ? minSeconds * 1.4 / (seconds / iterations) : iterations * 10.0;
+		iterations = static_cast<size_t>(min<double>(min<double>(wanted, iterations * 10.0), maxIterations));
+		iterations = max(iterations, static_cast<size_t>(state.iterations + 1));
+	}
+}
+
+bool writeJson(const string& path, const vector<BenchmarkResult>& results, double minSeconds) {
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+	char date[32];
+	time_t now = time(nullptr);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+#ifdef NDEBUG
+	const char* buildType = "release";
+#else
+	const char* buildType = "debug";
+#endif
+	fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"num_cpus\": %u,\n    \"build_type\": \"%s\",\n    \"min_time\": %g\n  },\n  \"benchmarks\": [",
+	        date, thread::hardware_concurrency(), buildType, minSeconds);
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		fprintf(file, "%s\n    {\"name\": \"%s/%zu\", \"operation\": \"%s\", \"scale\": %zu, \"iterations\": %zu, "
+		        "\"ns_per_op\": %.2f, \"items_per_second\": %.1f, \"allocations_per_op\": %.3f}",
+		        i > 0 ? "," : "", result.name.c_str(), result.scale, result.name.c_str(), result.scale, result.iterations,
+		        result.nanosecondsPerOperation, result.itemsPerSecond, result.allocationsPerOperation);
+	}
+	fprintf(file, "\n  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+// Mixed workload through the core API on a scratch inventory, 95% lookups and 5% changes, then stock adjustments, at 1 to 16 threads
+// Prints the throughput of each run and fails if the indexes disagree with the items afterwards
+int runStressTest(size_t itemCount, double secondsPerRun) {
+	Inventory inventory;
+	vector<string> ids;
+	ids.reserve(itemCount);
+	for (size_t i = 0; i < itemCount; i++) {
+		ids.push_back("s" + to_string(i));
+		inventory.insertItem(static_cast<CategoryTag>(i % categoryCount), ids.back(), "Stress item " + to_string(i), static_cast<int>(i % 100), Money::fromCents(100 + i % 1000));
+	}
+	long long expectedCount = static_cast<long long>(itemCount);
+	ItemQuery lowQuery;
+	string queryError;
+	Inventory::parseQuery("quantity<=5 ORDER BY price DESC LIMIT 20", lowQuery, queryError);
+
+	printf("%-8s %16s %16s\n", "Threads", "Ops/s", "Ops/s/thread");
+	for (size_t threadCount : {1, 2, 4, 8, 16}) {
+		atomic<bool> stop{false};
+		atomic<long long> operations{0}, added{0}, removed{0}, mismatches{0};
+		vector<thread> workers;
+		for (size_t t = 0; t < threadCount; t++) {
+			workers.emplace_back([&, t]() {
+				mt19937 random(static_cast<unsigned>(t * 7919 + threadCount));
+				ItemRecord record;
+				vector<string> own; // Items this worker added and may remove again
+				long long done = 0, ownAdded = 0, ownRemoved = 0;
+				while (!stop.load(memory_order_relaxed)) {
+					for (int i = 0; i < 64; i++, done++) {
+						const string& id = ids[random() % itemCount];
+						unsigned roll = random() % 100;
+						if (roll < 95 && done % 16384 == 0) {
+							// Now and then a listing copied under the shared lock while the other workers change items
+							CategoryTag tag = static_cast<CategoryTag>(random() % categoryCount);
+							for (const ItemRecord& listed : inventory.recordsInCategory(tag)) {
+								mismatches += listed.category != tag;
+							}
+							for (const ItemRecord& low : inventory.lowStockRecords()) {
+								mismatches += low.quantity > Inventory::defaultReorderLevel;
+							}
+							for (const ItemRecord& matched : inventory.queryRecords(lowQuery).items) {
+								mismatches += matched.quantity > 5;
+							}
+							for (ItemRecord& named : inventory.searchNameRecords("item 1", Inventory::nameSearchLimit)) {
+								transform(named.name.begin(), named.name.end(), named.name.begin(), ::tolower);
+								mismatches += named.name.find("item 1") == string::npos;
+							}
+							for (const ItemRecord& named : inventory.nameRecordsWithPrefix("worker", 20)) {
+								mismatches += named.category != CategoryTag::Electronics;
+							}
+							vector<ItemRecord> cheapest = inventory.sortedRecords({{SortField::Price, true}}, 20);
+							for (size_t k = 1; k < cheapest.size(); k++) {
+								mismatches += cheapest[k].price < cheapest[k - 1].price;
+							}
+						} else if (roll < 95) {
+							if (inventory.lookupItem(id, record) && record.id != id) {
+								mismatches++;
+							}
+						} else if (roll < 97) {
+							inventory.updateQuantity(id, static_cast<int>(random() % 100));
+						} else if (roll < 98) {
+							inventory.updatePrice(id, Money::fromCents(100 + random() % 1000));
+						} else if (roll < 99 || own.empty()) {
+							own.push_back("w" + to_string(threadCount) + "x" + to_string(t) + "x" + to_string(ownAdded));
+							ownAdded += inventory.insertItem(CategoryTag::Electronics, own.back(), "Worker item", 10, Money::fromCents(250));
+						} else {
+							ownRemoved += inventory.eraseItem(own.back());
+							own.pop_back();
+						}
+					}
+				}
+				operations += done;
+				added += ownAdded;
+				removed += ownRemoved;
+			});
+		}
+		this_thread::sleep_for(chrono::duration<double>(secondsPerRun));
+		stop = true;
+		for (thread& worker : workers) {
+			worker.join();
+		}
+
+		expectedCount += added - removed;
+		string error;
+		if (mismatches > 0) {
+			error = to_string(mismatches.load()) + " lookups or listings returned the wrong item";
+		} else if (static_cast<long long>(inventory.itemCount()) != expectedCount) {
+			error = "holds " + to_string(inventory.itemCount()) + " items instead of " + to_string(expectedCount);
+		}
+		if (!error.empty() || !inventory.verifyIndexes(error)) {
+			fprintf(stderr, "Stress test failed at %zu thread(s): %s\n", threadCount, error.c_str());
+			return 1;
+		}
+		double perSecond = operations / secondsPerRun;
+		printf("%-8zu %16.0f %16.0f\n", threadCount, perSecond, perSecond / threadCount);
+	}
+
+	// Stock adjustments, first spread over every item and then all on one item
+	// Every accepted delta is summed, the folded totals must move by exactly that much
+	vector<ItemHandle> handles;
+	handles.reserve(itemCount);
+	for (const string& id : ids) {
+		handles.push_back(inventory.findHandle(id));
+	}
+	printf("\n%-8s %20s %20s\n", "Threads", "Adjust/s (spread)", "Adjust/s (one item)");
+	for (size_t threadCount : {1, 2, 4, 8, 16}) {
+		double perSecond[2] = {};
+		for (int oneItem = 0; oneItem < 2; oneItem++) {
+			auto totalQuantity = [&inventory]() {
+				long long total = 0;
+				for (const CategoryInfo& info : categoryTable) {
+					total += inventory.getCategoryStats(info.tag).totalQuantity;
+				}
+				return total;
+			};
+			string error;
+			inventory.commitChanges(error); // No log is attached
+			long long before = totalQuantity();
+
+			atomic<bool> stop{false};
+			atomic<long long> operations{0}, applied{0};
+			vector<thread> workers;
+			for (size_t t = 0; t < threadCount; t++) {
+				workers.emplace_back([&, t]() {
+					mt19937 random(static_cast<unsigned>(t * 104729 + threadCount));
+					long long done = 0, net = 0;
+					while (!stop.load(memory_order_relaxed)) {
+						for (int i = 0; i < 64; i++, done++) {
+							ItemHandle handle = handles[oneItem ? 0 : random() % itemCount];
+							int delta = random() % 2 == 0 ? -1 : 1;
+							if (inventory.tryAdjustQuantity(handle, delta)) {
+								net += delta;
+							}
+						}
+					}
+					operations += done;
+					applied += net;
+				});
+			}
+			this_thread::sleep_for(chrono::duration<double>(secondsPerRun));
+			stop = true;
+			for (thread& worker : workers) {
+				worker.join();
+			}
+
+			inventory.commitChanges(error);
+			if (totalQuantity() != before + applied) {
+				error = "total quantity moved by " + to_string(totalQuantity() - before) + " instead of " + to_string(applied.load());
+			}
+			if (!error.empty() || !inventory.verifyIndexes(error)) {
+				fprintf(stderr, "Adjustment stress test failed at %zu thread(s): %s\n", threadCount, error.c_str());
+				return 1;
+			}
+			perSecond[oneItem] = operations / secondsPerRun;
+		}
+		printf("%-8zu %20.0f %20.0f\n", threadCount, perSecond[0], perSecond[1]);
+	}
+	return 0;
+}
+
+// Reference totals from one plain loop over the rows
+InventoryValuation naiveValuation(const int* quantities, const Money* prices, const CategoryTag* categories, size_t rowCount) {
+	InventoryValuation valuation;
+	for (size_t row = 0; row < rowCount; row++) {
+		ValuationTotals& totals = valuation.categories[static_cast<size_t>(categories[row])];
+		if (totals.itemCount == 0 || prices[row] < totals.minPrice) {
+			totals.minPrice = prices[row];
+		}
+		if (totals.itemCount == 0 || prices[row] > totals.maxPrice) {
+			totals.maxPrice = prices[row];
+		}
+		totals.itemCount++;
+		totals.totalQuantity += quantities[row];
+		totals.totalValue += prices[row] * quantities[row];
+		totals.priceSum += prices[row];
+	}
+	for (const ValuationTotals& totals : valuation.categories) {
+		if (totals.itemCount == 0) {
+			continue;
+		}
+		ValuationTotals& overall = valuation.overall;
+		overall.minPrice = overall.itemCount == 0 ? totals.minPrice : min(overall.minPrice, totals.minPrice);
+		overall.maxPrice = overall.itemCount == 0 ? totals.maxPrice : max(overall.maxPrice, totals.maxPrice);
+		overall.itemCount += totals.itemCount;
+		overall.totalQuantity += totals.totalQuantity;
+		overall.totalValue += totals.totalValue;
+		overall.priceSum += totals.priceSum;
+	}
+	return valuation;
+}
+
+// Every total is a whole number of cents, so any order of additions must give exactly the same result
+string compareValuations(const InventoryValuation& expected, const InventoryValuation& actual) {
+	for (size_t i = 0; i <= categoryCount; i++) {
+		const ValuationTotals& want = i < categoryCount ? expected.categories[i] : expected.overall;
+		const ValuationTotals& got = i < categoryCount ? actual.categories[i] : actual.overall;
+		if (want.itemCount != got.itemCount || want.totalQuantity != got.totalQuantity || want.totalValue != got.totalValue ||
+		    want.priceSum != got.priceSum || want.minPrice != got.minPrice || want.maxPrice != got.maxPrice) {
+			return string("totals of ") + (i < categoryCount ? categoryTable[i].name : "the whole inventory") + " differ";
+		}
+	}
+	return "";
+}
+
+// Valuation scans over bare columns, too many rows for a full inventory, checked against the plain loop
+// Also checks Inventory::valuation against the item getters on a smaller inventory
+int runValuationBenchmark(size_t rowCount, double minSeconds) {
+	mt19937 random(static_cast<unsigned>(rowCount));
+	vector<int> quantities(rowCount);
+	vector<Money> prices(rowCount);
+	vector<CategoryTag> categories(rowCount);
+	for (size_t row = 0; row < rowCount; row++) {
+		quantities[row] = static_cast<int>(random() % 200);
+		prices[row] = Money::fromCents(50 + random() % 99950);
+		categories[row] = static_cast<CategoryTag>(random() % categoryCount);
+	}
+
+	InventoryValuation expected = naiveValuation(quantities.data(), prices.data(), categories.data(), rowCount);
+	size_t coreCount = max<size_t>(1, thread::hardware_concurrency());
+	string error;
+	for (size_t threadCount : {size_t(1), size_t(4), coreCount}) {
+		error = compareValuations(expected, Inventory::valuateColumns(quantities.data(), prices.data(), categories.data(), rowCount, threadCount));
+		if (!error.empty()) {
+			fprintf(stderr, "Valuation with %zu thread(s) is wrong: %s\n", threadCount, error.c_str());
+			return 1;
+		}
+	}
+
+	Inventory inventory;
+	fillInventory(inventory, generateItems(min<size_t>(rowCount, 100000), 7));
+	vector<int> itemQuantities;
+	vector<Money> itemPrices;
+	vector<CategoryTag> itemCategories;
+	for (const Item* item : inventory.items()) {
+		itemQuantities.push_back(item->getItemQuantity());
+		itemPrices.push_back(item->getItemPrice());
+		itemCategories.push_back(Inventory::getCategoryTag(item));
+	}
+	error = compareValuations(naiveValuation(itemQuantities.data(), itemPrices.data(), itemCategories.data(), itemQuantities.size()), inventory.valuation());
+	if (!error.empty()) {
+		fprintf(stderr, "Inventory valuation is wrong: %s\n", error.c_str());
+		return 1;
+	}
+
+	vector<Benchmark> scans;
+	scans.push_back({"naive_loop", [&](BenchState& state, Fixture&) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += naiveValuation(quantities.data(), prices.data(), categories.data(), rowCount).overall.itemCount;
+		}
+	}});
+	scans.push_back({"valuation_one_thread", [&](BenchState& state, Fixture&) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += Inventory::valuateColumns(quantities.data(), prices.data(), categories.data(), rowCount, 1).overall.itemCount;
+		}
+	}});
+	scans.push_back({"valuation_all_threads", [&](BenchState& state, Fixture&) {
+		for (size_t i = 0; i < state.iterations; i++) {
+			state.itemsProcessed += Inventory::valuateColumns(quantities.data(), prices.data(), categories.data(), rowCount).overall.itemCount;
+		}
+	}});
+
+	Fixture fixture; // Unused, the scans read the columns above
+	printf("Results match the plain loop, %zu core(s)\n", coreCount);
+	printf("%-32s %12s %14s %16s\n", "Benchmark", "Iterations", "ms/scan", "Items/s");
+	for (const Benchmark& scan : scans) {
+		BenchmarkResult result = runBenchmark(scan, fixture, rowCount, minSeconds);
+		string name = result.name + "/" + to_string(rowCount);
+		printf("%-32s %12zu %14.3f %16.0f\n", name.c_str(), result.iterations, result.nanosecondsPerOperation / 1e6, result.itemsPerSecond);
+	}
+	return 0;
+}
+
+// Reference answer of a query from the item getters, every item is tested
+vector<string> referenceQuery(const Inventory& inventory, const ItemQuery& query) {
+	vector<Item*> matches;
+	for (Item* item : inventory.items()) {
+		bool matched = true;
+		for (const QueryCondition& condition : query.conditions) {
+			string id = item->getItemID(), name = item->getItemName();
+			toLowerCase(id);
+			toLowerCase(name);
+			long long value = condition.field == SortField::Quantity ? item->getItemQuantity()
+			                : condition.field == SortField::Price ? item->getItemPrice().getCents()
+			                : condition.field == SortField::Value ? item->getItemPrice().getCents() * item->getItemQuantity()
+			                : static_cast<long long>(Inventory::getCategoryTag(item));
+			bool holds = condition.field == SortField::ID ? id == condition.text
+			           : condition.field == SortField::Name ? name == condition.text
+			           : condition.low <= value && value <= condition.high;
+			matched = matched && holds != condition.negated;
+		}
+		if (matched) {
+			matches.push_back(item);
+		}
+	}
+	if (!query.order.empty()) {
+		vector<SortKey> keys = query.order;
+		keys.push_back({SortField::ID, true});
+		stable_sort(matches.begin(), matches.end(), [&keys](const Item* a, const Item* b) {
+			return Inventory::compareItems(a, b, keys);
+		});
+	}
+	vector<string> ids;
+	for (size_t i = 0; i < matches.size() && i < query.limit; i++) {
+		ids.push_back(matches[i]->getItemID());
+	}
+	return ids;
+}
+
+// Selective and broad queries over one inventory, each checked against every item and timed with and without the indexes
+// Without ORDER BY any LIMIT items may come back, so those queries are compared by count only
+int runQueryBenchmark(size_t itemCount, double minSeconds) {
+	static const char* queries[] = {
+		"id = clb500001",
+		"price BETWEEN 100 AND 101",
+		"category=el AND price<100 AND quantity BETWEEN 1 AND 10",
+		"quantity = 7 AND category = en",
+		"name = \"Blue Shirt 12345\"",
+		"category=el ORDER BY price DESC LIMIT 10",
+		"price > 999 ORDER BY quantity, name LIMIT 100",
+		"quantity >= 10",
+		"category=cl AND price<500 AND quantity>=10",
+		"category != en ORDER BY price LIMIT 1000",
+		"category=el ORDER BY quantity LIMIT 10",
+		"quantity > 0 ORDER BY value DESC LIMIT 100",
+		"quantity < 20 ORDER BY name DESC",
+		"LIMIT 100",
+	};
+
+	Fixture fixture;
+	fixture.items = generateItems(itemCount, static_cast<unsigned>(itemCount));
+	fillInventory(fixture.inventory, fixture.items);
+
+	printf("%-16s %10s %10s %14s %14s  %s\n", "Plan", "Matches", "Examined", "ms planned", "ms scan", "Query");
+	for (const char* text : queries) {
+		ItemQuery query;
+		string error;
+		if (!Inventory::parseQuery(text, query, error)) {
+			fprintf(stderr, "Cannot parse %s: %s\n", text, error.c_str());
+			return 1;
+		}
+		ItemQuery scanned(query);
+		scanned.useIndexes = false;
+
+		vector<string> expected = referenceQuery(fixture.inventory, query);
+		QueryResult planned = fixture.inventory.runQuery(query);
+		for (const QueryResult& result : {planned, fixture.inventory.runQuery(scanned)}) {
+			bool same = result.items.size() == expected.size();
+			for (size_t i = 0; same && !query.order.empty() && i < expected.size(); i++) {
+				same = result.items[i]->getItemID() == expected[i];
+			}
+			if (!same) {
+				fprintf(stderr, "Query \"%s\" by %s returned %zu item(s) instead of %zu\n", text,
+				        Inventory::getQueryAccessName(result.access), result.items.size(), expected.size());
+				return 1;
+			}
+		}
+
+		double milliseconds[2];
+		for (int i = 0; i < 2; i++) {
+			const ItemQuery& timed = i == 0 ? query : scanned;
+			Benchmark benchmark = {"query", [&](BenchState& state, Fixture&) {
+				for (size_t j = 0; j < state.iterations; j++) {
+					state.itemsProcessed += fixture.inventory.runQuery(timed).items.size();
+				}
+			}};
+			milliseconds[i] = runBenchmark(benchmark, fixture, itemCount, minSeconds).nanosecondsPerOperation / 1e6;
+		}
+		printf("%-16s %10zu %10zu %14.3f %14.3f  %s\n", Inventory::getQueryAccessName(planned.access), planned.items.size(),
+		       planned.examined, milliseconds[0], milliseconds[1], text);
+		fflush(stdout);
+	}
+	printf("Results match a test of every item, %zu items\n", itemCount);
+	return 0;
+}
+
+// First K items against the whole order for K = 10, 100 and 1000, checked against the full sort
+// Single quantity and price keys walk their views, other keys select with bounded heaps
+int runTopKBenchmark(size_t itemCount, double minSeconds) {
+	struct Order {
+		const char* name;
+		vector<SortKey> keys;
+	};
+	const Order orders[] = {
+		{"lowest_stock", {{SortField::Quantity, true}}},
+		{"most_expensive", {{SortField::Price, false}}},
+		{"most_valuable", {{SortField::Value, false}}},
+		{"least_valuable_by_name", {{SortField::Value, true}, {SortField::Name, true}}},
+		{"category_name", {{SortField::Category, true}, {SortField::Name, true}}},
+	};
+
+	Fixture fixture;
+	fixture.items = generateItems(itemCount, static_cast<unsigned>(itemCount));
+	fillInventory(fixture.inventory, fixture.items);
+
+	printf("%-32s %14s %14s %14s %14s\n", "Order", "ms full", "ms K=10", "ms K=100", "ms K=1000");
+	for (const Order& order : orders) {
+		vector<Item*> full = fixture.inventory.sortedItems(order.keys);
+		Benchmark benchmark = {"full", [&](BenchState& state, Fixture&) {
+			for (size_t i = 0; i < state.iterations; i++) {
+				state.itemsProcessed += fixture.inventory.sortedItems(order.keys).size();
+			}
+		}};
+		double fullMilliseconds = runBenchmark(benchmark, fixture, itemCount, minSeconds).nanosecondsPerOperation / 1e6;
+
+		double milliseconds[3];
+		const size_t limits[] = {10, 100, 1000};
+		for (int i = 0; i < 3; i++) {
+			size_t limit = limits[i];
+			vector<Item*> top = fixture.inventory.sortedItems(order.keys, limit);
+			if (top.size() != min(limit, full.size()) || !equal(top.begin(), top.end(), full.begin())) {
+				fprintf(stderr, "The first %zu items by %s differ from the full sort\n", limit, order.name);
+				return 1;
+			}
+			benchmark.body = [&](BenchState& state, Fixture&) {
+				for (size_t j = 0; j < state.iterations; j++) {
+					state.itemsProcessed += fixture.inventory.sortedItems(order.keys, limit).size();
+				}
+			};
+			milliseconds[i] = runBenchmark(benchmark, fixture, itemCount, minSeconds).nanosecondsPerOperation / 1e6;
+		}
+		printf("%-32s %14.3f %14.3f %14.3f %14.3f\n", order.name, fullMilliseconds, milliseconds[0], milliseconds[1], milliseconds[2]);
+		fflush(stdout);
+	}
+	printf("First K items match the full sort, %zu items, %u core(s)\n", itemCount, max(1u, thread::hardware_concurrency()));
+	return 0;
+}
+
+// Counts the self-checks and prints each failure
+struct CheckReport {
+	size_t passed = 0;
+	size_t failed = 0;
+
+	void expect(bool condition, const string& what) {
+		if (condition) {
+			passed++;
+		} else {
+			failed++;
+			printf("FAILED: %s\n", what.c_str());
+		}
+	}
+};
+
+// Every registry entry parses back to its tag, builds items of its category and survives a snapshot and the log
+void checkCategoryRegistry(CheckReport& report) {
+	const string snapshotPath = "inventory_check.snap", logPath = "inventory_check.wal";
+	remove(snapshotPath.c_str());
+	remove(logPath.c_str());
+	string error;
+
+	Inventory scratch;
+	for (size_t i = 0; i < categoryCount; i++) {
+		const CategoryInfo& info = categoryTable[i];
+		string code = info.code, upperCode = info.code;
+		for (char& c : upperCode) {
+			c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+		}
+		CategoryTag tag = CategoryTag();
+		report.expect(static_cast<size_t>(info.tag) == i, string(info.name) + " is listed in tag order");
+		report.expect(Inventory::parseCategoryCode(code, tag) && tag == info.tag, "code " + code + " parses back to its tag");
+		report.expect(Inventory::parseCategoryCode(upperCode, tag) && tag == info.tag, "code " + upperCode + " parses in any case");
+		report.expect(string(Inventory::getCategoryName(info.tag)) == info.name && string(Inventory::getCategoryCode(info.tag)) == code,
+		              string(info.name) + " name and code come from the table");
+		Item* item = scratch.createItem(info.tag, code + "1", "Item", 1, Money::fromCents(100));
+		report.expect(item->getCategoryTag() == info.tag && Inventory::getCategory(item) == info.name && string(item->getItemCategory()) == info.name,
+		              string(info.name) + " items know their category");
+		scratch.destroyItem(item);
+	}
+
+	// Two items per category reach the snapshot, a third only the log
+	{
+		OperationLog log;
+		Inventory source;
+		report.expect(log.open(logPath, error), "the check log opens");
+		source.attachLog(&log, snapshotPath);
+		for (size_t i = 0; i < categoryCount; i++) {
+			string code = categoryTable[i].code;
+			source.insertItem(categoryTable[i].tag, code + "1", "First", static_cast<int>(i + 1), Money::fromCents(100));
+			source.insertItem(categoryTable[i].tag, code + "2", "Second", static_cast<int>(i + 2), Money::fromCents(200));
+			source.setCategoryReorderLevel(categoryTable[i].tag, static_cast<int>(10 + i));
+		}
+		report.expect(source.commitChanges(error), "the registry log commits");
+		report.expect(source.saveSnapshot(snapshotPath, error), "the registry snapshot saves");
+		for (size_t i = 0; i < categoryCount; i++) {
+			source.insertItem(categoryTable[i].tag, string(categoryTable[i].code) + "3", "Third", 3, Money::fromCents(300));
+		}
+		report.expect(source.commitChanges(error), "the registry log commits after the snapshot");
+		source.attachLog(nullptr, snapshotPath);
+	}
+
+	Inventory restored;
+	report.expect(restored.loadSnapshot(snapshotPath, error), "the registry snapshot loads: " + error);
+	ItemRecord record;
+	for (size_t i = 0; i < categoryCount; i++) {
+		const CategoryInfo& info = categoryTable[i];
+		string code = info.code;
+		report.expect(restored.lookupItem(code + "2", record) && record.category == info.tag, string(info.name) + " items keep their category in a snapshot");
+		report.expect(!restored.lookupItem(code + "3", record), string(info.name) + " items added after the snapshot are not in it");
+		report.expect(restored.getCategoryReorderLevel(info.tag) == static_cast<int>(10 + i), string(info.name) + " reorder level survives a snapshot");
+	}
+	OperationLog log;
+	report.expect(log.open(logPath, error) && log.replay(restored, error), "the registry log replays: " + error);
+	for (size_t i = 0; i < categoryCount; i++) {
+		const CategoryInfo& info = categoryTable[i];
+		report.expect(restored.lookupItem(string(info.code) + "3", record) && record.category == info.tag, string(info.name) + " items keep their category in the log");
+		report.expect(restored.getCategoryStats(info.tag).itemCount == 3, string(info.name) + " holds every item after the replay");
+	}
+	string indexError;
+	report.expect(restored.verifyIndexes(indexError), "indexes agree after the registry round trip: " + indexError);
+	remove(snapshotPath.c_str());
+	remove(logPath.c_str());
+}
+
+// Amount parsing and formatting at the edges, and the price limit on every way in
+void checkMoney(CheckReport& report) {
+	struct Case {
+		const char* text;
+		bool parses;
+		int64_t cents;
+	};
+	const Case cases[] = {
+		{"12", true, 1200}, {"12.5", true, 1250}, {"12.05", true, 1205}, {".99", true, 99}, {"7.", true, 700}, {"0", true, 0},
+		{"92233720368547758.07", true, numeric_limits<int64_t>::max()},
+		{"", false, 0}, {".", false, 0}, {"-1", false, 0}, {"+1", false, 0}, {"-.5", false, 0}, {"1.234", false, 0}, {"1.2.3", false, 0},
+		{"1e5", false, 0}, {" 1", false, 0}, {"1,000", false, 0}, {"92233720368547758.08", false, 0}, {"99999999999999999999", false, 0},
+	};
+	for (const Case& test : cases) {
+		Money amount = Money::fromCents(-1);
+		bool parsed = Money::parse(test.text, amount);
+		report.expect(parsed == test.parses && (!parsed || amount.getCents() == test.cents), string("Money::parse(\"") + test.text + "\")");
+	}
+	report.expect(Money::fromCents(-1250).toString() == "-12.50" && Money::fromCents(5).toString() == "0.05", "negative and small amounts format");
+	report.expect(Money::fromCents(numeric_limits<int64_t>::min()).toString() == "-92233720368547758.08", "the most negative amount formats");
+
+	Money price;
+	report.expect(Money::parsePrice("1000000", price) && price.getCents() == Money::maxPriceCents, "the largest price parses");
+	report.expect(!Money::parsePrice("1000000.01", price) && !Money::parsePrice("0", price) && !Money::parsePrice("0.00", price),
+	              "prices above the limit or not positive are refused");
+	Money largest = Money::fromCents(Money::maxPriceCents) * numeric_limits<int>::max();
+	report.expect(largest.getCents() / numeric_limits<int>::max() == Money::maxPriceCents, "the largest price times the largest quantity fits");
+
+	Inventory inventory;
+	string batchReport;
+	report.expect(!inventory.insertItem(CategoryTag::Electronics, "el1", "Big", 1000, Money::fromCents(Money::maxPriceCents + 1)), "insertItem refuses an over-limit price");
+	report.expect(inventory.runBatch("add el 1 big 1000 92233720368547758\nadd el 2 big 1000 1000000.01\n", batchReport) == 2 &&
+	              batchReport.find("ok") == string::npos, "batch add refuses over-limit prices");
+	batchReport.clear();
+	report.expect(inventory.runBatch("add el 3 big " + to_string(numeric_limits<int>::max()) + " 1000000\nupdate el3 price 1000000.01\n", batchReport) == 1,
+	              "batch update refuses an over-limit price");
+	InventoryValuation valuation = inventory.valuation();
+	report.expect(valuation.overall.totalValue == largest, "the stock value of an item at both limits is exact");
+
+	// A hundred items at both limits pass the Money range, the totals stay exact and go back when items leave
+	for (int i = 4; i < 103; i++) {
+		inventory.insertItem(CategoryTag::Electronics, "el" + to_string(i), "Big", numeric_limits<int>::max(), Money::fromCents(Money::maxPriceCents));
+	}
+	MoneyTotal hundred;
+	hundred.addTimes(largest, 100);
+	valuation = inventory.valuation();
+	report.expect(valuation.overall.totalValue == hundred && inventory.getCategoryStats(CategoryTag::Electronics).totalValue == hundred,
+	              "stock values past the Money range are summed exactly");
+	report.expect(!hundred.fitsMoney() && hundred.toString() == "214748364700000000.00" && hundred.toMoney().getCents() == numeric_limits<int64_t>::max(),
+	              "a total past the Money range formats every digit and saturates as Money");
+	MoneyTotal owed;
+	owed.addTimes(Money::fromCents(-largest.getCents()), 100);
+	report.expect(owed.toString() == "-214748364700000000.00", "a negative total past the Money range formats");
+	batchReport.clear();
+	report.expect(inventory.runBatch("value el\n", batchReport) == 0 && batchReport.find(" value 214748364700000000.00 ") != string::npos,
+	              "batch value prints a total past the Money range");
+
+	int quantity = 0;
+	report.expect(!inventory.adjustQuantity("el4", 1) && !inventory.tryAdjustQuantity("el4", 1), "adjusting past the largest quantity is refused");
+	report.expect(inventory.adjustQuantity("el5", numeric_limits<int>::min(), &quantity) && quantity == -1 &&
+	              !inventory.adjustQuantity("el5", numeric_limits<int>::min()) && !inventory.tryAdjustQuantity("el5", -1),
+	              "adjusting below the smallest quantity is refused");
+	MoneyTotal adjusted = hundred;
+	adjusted -= largest;
+	adjusted -= Money::fromCents(Money::maxPriceCents);
+	string error;
+	inventory.commitChanges(error); // Folds the adjustments into the totals
+	valuation = inventory.valuation();
+	report.expect(inventory.getCategoryStats(CategoryTag::Electronics).totalValue == adjusted && valuation.overall.totalValue == adjusted,
+	              "a negative quantity is valued exactly");
+	for (int i = 4; i < 103; i++) {
+		inventory.eraseItem("el" + to_string(i));
+	}
+	report.expect(inventory.getCategoryStats(CategoryTag::Electronics).totalValue == largest, "removed items leave the running total exact");
+}
+
+// Quoting, the ID prefix, duplicates and malformed rows of a CSV import, then an export and import round trip
+void checkCsvImport(CheckReport& report) {
+	const string csvPath = "inventory_check.csv", exportPath = "inventory_check_export.csv";
+	const char* rows =
+		"category,id,name,quantity,price\n"
+		"cl,cl1,Plain shirt,3,9.99\n"
+		"el,EL2,\"Cable, long \"\"XL\"\"\",4,1.50\n"
+		"cl,999,No prefix,1,1.00\n"
+		"cl,el5,Wrong prefix,1,1.00\n"
+		"cl,cl,Only the code,1,1.00\n"
+		"cl,cl1,Duplicate,1,1.00\n"
+		"en,en3,Bad quantity,x,1.00\n"
+		"en,en4,Zero quantity,0,1.00\n"
+		"en,en5,Bad price,1,1.999\n"
+		"en,en6,Huge price,1,1000000.01\n"
+		"en,en7,Four columns,1\n"
+		"en,en8,Six columns,1,1.00,extra\n"
+		"en,en9,\"Unterminated,1,1.00\n"
+		"xx,xx1,Bad category,1,1.00\n"
+		"\n"
+		"en,en10,Windows line,2,2.00\r\n"
+		"cl,cl11,,1,1.00\n"
+		"en,en12,Taken,1,1.00\n";
+	FILE* file = fopen(csvPath.c_str(), "wb");
+	report.expect(file != nullptr && fputs(rows, file) >= 0 && fclose(file) == 0, "the check CSV is written");
+
+	Inventory inventory;
+	inventory.insertItem(CategoryTag::Entertainment, "en12", "Existing", 1, Money::fromCents(100));
+	CsvImportResult result = inventory.importCsv(csvPath);
+	report.expect(result.failure.empty() && result.imported == 3 && result.rejected == 14,
+	              "CSV import takes 3 rows and rejects 14, took " + to_string(result.imported) + " and rejected " + to_string(result.rejected));
+	auto reported = [&result](const string& message) {
+		return find(result.errors.begin(), result.errors.end(), message) != result.errors.end();
+	};
+	report.expect(reported("line 4: id must start with the category code cl") && reported("line 5: id must start with the category code cl") &&
+	              reported("line 6: id must start with the category code cl"), "CSV IDs without their category code are rejected");
+	report.expect(reported("line 7: duplicate id cl1") && reported("line 19: duplicate id en12"), "CSV duplicates within the file and of stored items are rejected");
+	report.expect(reported("line 12: expected 5 columns") && reported("line 13: expected 5 columns") && reported("line 14: expected 5 columns"),
+	              "CSV rows with too few or too many columns or an open quote are rejected");
+
+	ItemRecord record;
+	report.expect(inventory.lookupItem("el2", record) && record.name == Inventory::capitalizeFirstLetter("Cable, long \"XL\"") && record.quantity == 4 &&
+	              record.price == Money::fromCents(150) && record.category == CategoryTag::Electronics, "quoted CSV names keep commas and quotes");
+	report.expect(inventory.lookupItem("en10", record) && record.price == Money::fromCents(200), "CSV lines ending in CR LF import");
+	report.expect(inventory.lookupItem("en12", record) && record.name == "Existing", "a CSV duplicate leaves the stored item alone");
+
+	double megabytesPerSecond = 0;
+	string error;
+	report.expect(inventory.exportCsv(exportPath, megabytesPerSecond, error), "the CSV export is written");
+	Inventory reimported;
+	result = reimported.importCsv(exportPath);
+	bool same = result.imported == inventory.itemCount() && result.rejected == 0;
+	for (const Item* item : inventory.items()) {
+		same = same && reimported.lookupItem(item->getItemID(), record) && record.name == item->getItemName() && record.quantity == item->getItemQuantity() &&
+		       record.price == item->getItemPrice() && record.category == item->getCategoryTag();
+	}
+	report.expect(same, "a CSV export imports back to the same items");
+
+	// One-byte chunks start a chunk at every line, only the first line of the file is the header
+	file = fopen(csvPath.c_str(), "wb");
+	report.expect(file != nullptr && fputs("category,id,name,quantity,price\ncl,cl1,Shirt,1,1.00\ncategory,id,name,quantity,price\nel,el2,Cable,2,2.00\n", file) >= 0 &&
+	              fclose(file) == 0, "the chunked check CSV is written");
+	for (size_t chunkSize : {size_t(1), size_t(64) << 20}) {
+		Inventory chunked;
+		chunked.csvChunkSize = chunkSize;
+		result = chunked.importCsv(csvPath);
+		report.expect(result.imported == 2 && result.rejected == 1 && result.errors.size() == 1 && result.errors[0].rfind("line 3: category must be", 0) == 0,
+		              "a header row after line 1 is rejected with " + to_string(chunkSize) + "-byte chunks");
+	}
+	remove(csvPath.c_str());
+	remove(exportPath.c_str());
+}
+
+// Replay stops at a torn or corrupt record and keeps everything before it, and a failed commit is written again later
+void checkOperationLog(CheckReport& report) {
+	const string logPath = "inventory_check.wal", snapshotPath = "inventory_check.snap";
+	auto readFile = [](const string& path) {
+		ifstream input(path, ios::binary);
+		return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	};
+	auto writeFile = [](const string& path, const string& data) {
+		ofstream output(path, ios::binary | ios::trunc);
+		output.write(data.data(), static_cast<streamsize>(data.size()));
+	};
+	auto replayed = [&](Inventory& inventory, string& error) {
+		OperationLog log;
+		return log.open(logPath, error) && log.replay(inventory, error);
+	};
+	remove(logPath.c_str());
+	string error;
+	size_t firstRecordSize = 0;
+	{
+		OperationLog log;
+		Inventory source;
+		report.expect(log.open(logPath, error), "the check log opens");
+		source.attachLog(&log, snapshotPath);
+		source.insertItem(CategoryTag::Clothing, "cl1", "First", 1, Money::fromCents(100));
+		source.commitChanges(error);
+		firstRecordSize = readFile(logPath).size();
+		source.insertItem(CategoryTag::Electronics, "el2", "Second", 2, Money::fromCents(200));
+		source.insertItem(CategoryTag::Entertainment, "en3", "Third", 3, Money::fromCents(300));
+		source.updateQuantity("cl1", 7);
+		report.expect(source.commitChanges(error), "the check log commits");
+		source.attachLog(nullptr, snapshotPath);
+	}
+	const string complete = readFile(logPath);
+	ItemRecord record;
+
+	Inventory whole;
+	report.expect(replayed(whole, error) && whole.itemCount() == 3 && whole.lookupItem("cl1", record) && record.quantity == 7, "a complete log replays every record");
+
+	writeFile(logPath, complete + complete.substr(0, 10));
+	Inventory tornHeader;
+	report.expect(!replayed(tornHeader, error) && error == "Ignored 10 bytes of incomplete log records." && tornHeader.itemCount() == 3 &&
+	              tornHeader.lookupItem("cl1", record) && record.quantity == 7, "a torn record header at the end is ignored: " + error);
+
+	writeFile(logPath, complete.substr(0, complete.size() - 5));
+	Inventory tornRecord;
+	report.expect(!replayed(tornRecord, error) && tornRecord.itemCount() == 3 && tornRecord.lookupItem("cl1", record) && record.quantity == 1,
+	              "a record cut short at the end is dropped with nothing after it");
+
+	string corrupt = complete;
+	corrupt[firstRecordSize + 30] ^= 0x20; // Inside the second record's ID or name
+	writeFile(logPath, corrupt);
+	Inventory corrupted;
+	report.expect(!replayed(corrupted, error) && corrupted.itemCount() == 1 && corrupted.lookupItem("cl1", record) && record.quantity == 1,
+	              "replay stops at a record that fails its checksum");
+
+#ifndef _WIN32
+	// Writes past the file size limit fail, the part that got through is cut off and the next commit writes the records again
+	writeFile(logPath, complete);
+	{
+		OperationLog log;
+		Inventory target;
+		report.expect(log.open(logPath, error) && log.replay(target, error), "the check log replays before the failed commit");
+		target.attachLog(&log, snapshotPath);
+		struct rlimit original;
+		getrlimit(RLIMIT_FSIZE, &original);
+		struct rlimit limited = original;
+		limited.rlim_cur = complete.size() + 30;
+		void (*previousHandler)(int) = signal(SIGXFSZ, SIG_IGN);
+		setrlimit(RLIMIT_FSIZE, &limited);
+		target.insertItem(CategoryTag::Clothing, "cl4", string(200, 'n'), 4, Money::fromCents(400));
+		bool committed = target.commitChanges(error);
+		setrlimit(RLIMIT_FSIZE, &original);
+		signal(SIGXFSZ, previousHandler);
+		report.expect(!committed && !error.empty() && !log.lastError().empty(), "a commit past the size limit fails: " + error);
+		report.expect(readFile(logPath) == complete, "a failed commit leaves no partial record behind");
+		string batchReport;
+		report.expect(target.runBatch("query cl4\n", batchReport) == 0 && batchReport.find("log: error") == string::npos, "the next commit writes the pending records");
+		target.attachLog(nullptr, snapshotPath);
+	}
+	Inventory retried;
+	report.expect(replayed(retried, error) && retried.itemCount() == 4 && retried.lookupItem("cl4", record) && record.name.size() == 200,
+	              "records of a failed commit replay once after the retry");
+#endif
+
+	// Compaction empties the log only after the snapshot is saved, a failed save keeps every record
+	remove(logPath.c_str());
+	for (bool snapshotWritable : {false, true}) {
+		string compactedSnapshot = snapshotWritable ? snapshotPath : "inventory_check_missing/inventory.snap";
+		OperationLog log;
+		Inventory source;
+		report.expect(log.open(logPath, error), "the compaction log opens");
+		log.compactionThreshold = 1;
+		source.attachLog(&log, compactedSnapshot);
+		source.insertItem(CategoryTag::Clothing, "cl1", "First", 1, Money::fromCents(100));
+		bool committed = source.commitChanges(error);
+		source.attachLog(nullptr, compactedSnapshot);
+		size_t logBytes = readFile(logPath).size();
+		if (snapshotWritable) {
+			Inventory restored;
+			report.expect(committed && logBytes == 0 && restored.loadSnapshot(snapshotPath, error) && restored.itemCount() == 1,
+			              "compaction saves the snapshot and then empties the log");
+		} else {
+			report.expect(committed && logBytes > 0, "a compaction whose snapshot fails keeps the log");
+		}
+	}
+	remove(snapshotPath.c_str());
+	remove(logPath.c_str());
+}
+
+// One item of a snapshot built by hand
+struct SnapshotFileItem {
+	uint8_t category;
+	string id;
+	string name;
+	int32_t quantity;
+	int64_t cents;
+	int32_t reorderLevel;
+};
+
+// Snapshot file as each version wrote it: a 32-byte header, 32-byte records, reorder levels, then the string pool
+// Version 1 has no reorder levels and version 2 no category count, prices are doubles before version 3
+string snapshotFile(uint32_t version, const vector<SnapshotFileItem>& items, const vector<int32_t>& categoryLevels) {
+	string records, levels, pool;
+	for (const SnapshotFileItem& item : items) {
+		char record[32] = {};
+		int64_t price = item.cents;
+		if (version < 3) {
+			double amount = item.cents / 100.0;
+			memcpy(&price, &amount, sizeof(price));
+		}
+		uint32_t strings[4] = {static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(item.id.size()),
+		                       static_cast<uint32_t>(pool.size() + item.id.size()), static_cast<uint32_t>(item.name.size())};
+		memcpy(record, &price, sizeof(price));
+		memcpy(record + 8, strings, sizeof(strings));
+		memcpy(record + 24, &item.quantity, sizeof(item.quantity));
+		record[28] = static_cast<char>(item.category);
+		records.append(record, sizeof(record));
+		levels.append(reinterpret_cast<const char*>(&item.reorderLevel), sizeof(item.reorderLevel));
+		pool += item.id + item.name;
+	}
+	if (version < 2) {
+		levels.clear();
+	} else {
+		if (version >= 4) {
+			int32_t count = static_cast<int32_t>(categoryLevels.size());
+			levels.append(reinterpret_cast<const char*>(&count), sizeof(count));
+		}
+		levels.append(reinterpret_cast<const char*>(categoryLevels.data()), categoryLevels.size() * sizeof(int32_t));
+	}
+
+	uint64_t checksum = 14695981039346656037ULL; // FNV-1a over everything after the header
+	for (unsigned char c : records + levels + pool) {
+		checksum = (checksum ^ c) * 1099511628211ULL;
+	}
+	uint64_t counts[3] = {items.size(), pool.size(), checksum};
+	char header[32] = {'I', 'N', 'V', 'S'};
+	memcpy(header + 4, &version, sizeof(version));
+	memcpy(header + 8, counts, sizeof(counts));
+	return string(header, sizeof(header)) + records + levels + pool;
+}
+
+// Every snapshot version loads, a loaded snapshot saves back unchanged, and sizes or IDs that do not add up are refused
+void checkSnapshots(CheckReport& report) {
+	const string snapshotPath = "inventory_check.snap", resavedPath = "inventory_check_resaved.snap";
+	auto readFile = [](const string& path) {
+		ifstream input(path, ios::binary);
+		return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	};
+	auto writeFile = [](const string& path, const string& data) {
+		ofstream output(path, ios::binary | ios::trunc);
+		output.write(data.data(), static_cast<streamsize>(data.size()));
+	};
+	const vector<SnapshotFileItem> items = {
+		{0, "cl1", "Old Shirt", 4, 1250, 7},
+		{1, "el2", "Old Radio", 9, 99, Inventory::useCategoryReorderLevel},
+		{2, "en3", "Old Novel", 2, 100000000, 0},
+	};
+	const vector<int32_t> levels = {3, 10, 6};
+	string error;
+	ItemRecord record;
+
+	for (uint32_t version = 1; version <= 4; version++) {
+		string name = "version " + to_string(version) + " snapshot";
+		writeFile(snapshotPath, snapshotFile(version, items, levels));
+		Inventory loaded;
+		report.expect(loaded.loadSnapshot(snapshotPath, error) && loaded.itemCount() == items.size(), name + " loads: " + error);
+		bool same = true;
+		for (const SnapshotFileItem& item : items) {
+			same = same && loaded.lookupItem(item.id, record) && record.name == item.name && record.quantity == item.quantity &&
+			       record.price == Money::fromCents(item.cents) && static_cast<uint8_t>(record.category) == item.category;
+		}
+		report.expect(same, name + " keeps every item");
+		bool levelsKept = true;
+		for (size_t i = 0; i < items.size(); i++) {
+			int categoryLevel = version >= 2 ? levels[i] : Inventory::defaultReorderLevel;
+			int itemLevel = version >= 2 && items[i].reorderLevel != Inventory::useCategoryReorderLevel ? items[i].reorderLevel : categoryLevel;
+			const Item* item = loaded.resolve(loaded.findHandle(items[i].id));
+			levelsKept = levelsKept && item != nullptr && loaded.getCategoryReorderLevel(static_cast<CategoryTag>(items[i].category)) == categoryLevel &&
+			             loaded.getReorderLevel(item) == itemLevel;
+		}
+		report.expect(levelsKept, name + " keeps the item and category reorder levels");
+
+		// Saving writes the current version, which must load to the same inventory and save to the same bytes
+		Inventory reloaded;
+		report.expect(loaded.saveSnapshot(resavedPath, error) && reloaded.loadSnapshot(resavedPath, error), name + " saves and loads again: " + error);
+		string resaved = readFile(resavedPath);
+		report.expect(reloaded.saveSnapshot(resavedPath, error) && readFile(resavedPath) == resaved && reloaded.itemCount() == items.size(),
+		              name + " saves back to the same bytes");
+		string indexError;
+		report.expect(reloaded.verifyIndexes(indexError), name + " indexes agree after the round trip: " + indexError);
+	}
+
+	// Hostile sizes in an otherwise valid file, none may reach past the end of it
+	const string valid = snapshotFile(4, items, levels);
+	auto patched = [&valid](size_t offset, const void* value, size_t size) {
+		string file = valid;
+		memcpy(&file[offset], value, size);
+		return file;
+	};
+	uint64_t hugePool = 1ULL << 63, wrappingPool = ~0ULL - 40, hugeCount = ~0ULL / 32 + 1;
+	uint32_t hugeCategories = ~0U;
+	size_t categoryCountOffset = 32 + items.size() * 36;
+	const pair<string, string> hostile[] = {
+		{"a string pool size near 2^63", patched(16, &hugePool, sizeof(hugePool))},
+		{"a string pool size that wraps the total", patched(16, &wrappingPool, sizeof(wrappingPool))},
+		{"an item count past the file", patched(8, &hugeCount, sizeof(hugeCount))},
+		{"a category count past the file", patched(categoryCountOffset, &hugeCategories, sizeof(hugeCategories))},
+		{"a trailing byte", valid + '\0'},
+		{"a file cut inside the pool", valid.substr(0, valid.size() - 1)},
+	};
+	for (const auto& test : hostile) {
+		writeFile(snapshotPath, test.second);
+		Inventory target;
+		target.insertItem(CategoryTag::Clothing, "cl9", "Kept", 1, Money::fromCents(100));
+		report.expect(!target.loadSnapshot(snapshotPath, error) && error.find("is truncated") != string::npos && target.itemCount() == 1,
+		              "a snapshot with " + test.first + " is refused and the inventory is kept: " + error);
+	}
+
+	vector<SnapshotFileItem> repeated = items;
+	repeated.push_back({0, "cl1", "Copy", 1, 100, 0});
+	writeFile(snapshotPath, snapshotFile(4, repeated, levels));
+	Inventory duplicates;
+	report.expect(!duplicates.loadSnapshot(snapshotPath, error) && error == "Snapshot " + snapshotPath + " repeats the item ID cl1." &&
+	              duplicates.itemCount() == 0, "a snapshot that repeats an ID is refused as corrupt: " + error);
+
+#ifndef _WIN32
+	// A save that cannot be written completely leaves the previous snapshot in place and no temporary file behind
+	writeFile(snapshotPath, valid);
+	{
+		Inventory large;
+		large.insertItem(CategoryTag::Clothing, "cl1", string(2000, 'n'), 1, Money::fromCents(100));
+		struct rlimit original;
+		getrlimit(RLIMIT_FSIZE, &original);
+		struct rlimit limited = original;
+		limited.rlim_cur = valid.size() + 100;
+		void (*previousHandler)(int) = signal(SIGXFSZ, SIG_IGN);
+		setrlimit(RLIMIT_FSIZE, &limited);
+		bool saved = large.saveSnapshot(snapshotPath, error);
+		setrlimit(RLIMIT_FSIZE, &original);
+		signal(SIGXFSZ, previousHandler);
+		report.expect(!saved && readFile(snapshotPath) == valid && !ifstream(snapshotPath + ".tmp").good(),
+		              "a failed save keeps the previous snapshot: " + error);
+	}
+#endif
+	Inventory nowhere;
+	report.expect(!nowhere.saveSnapshot("inventory_check_missing/inventory.snap", error), "a save into a missing directory fails: " + error);
+	remove(snapshotPath.c_str());
+	remove(resavedPath.c_str());
+}
+
+// Empty quoted tokens, comments and unterminated quotes in batch text
+void checkBatchParsing(CheckReport& report) {
+	Inventory inventory;
+	string batchReport;
+	report.expect(inventory.runBatch("\"\" x\n  \n# comment\n\"\"\n\"open\n", batchReport) == 3 &&
+	              batchReport == "1: error unknown command \n4: error unknown command \n5: error unterminated quote\n",
+	              "an empty first token is an unknown command: " + batchReport);
+}
+
+// Bulk removal sees pending adjustments, and a batch remove of several IDs fails and names the ones not found
+void checkBulkRemoval(CheckReport& report) {
+	Inventory inventory;
+	inventory.insertItem(CategoryTag::Clothing, "cl1", "First", 1, Money::fromCents(100));
+	inventory.insertItem(CategoryTag::Electronics, "el2", "Second", 2, Money::fromCents(200));
+	inventory.insertItem(CategoryTag::Entertainment, "en3", "Third", 3, Money::fromCents(300));
+	inventory.insertItem(CategoryTag::Clothing, "cl4", "Fourth", 4, Money::fromCents(400));
+	inventory.tryAdjustQuantity("cl1", -1);
+	report.expect(inventory.removeItems([](const Item* item) { return item->getItemQuantity() == 0; }) == 1 && inventory.itemCount() == 3,
+	              "removeItems by predicate sees the pending adjustments");
+	report.expect(inventory.removeItems(vector<string>{"EL2", "nope"}) == 1 && inventory.itemCount() == 2, "removeItems by ID lowercases and skips unknown IDs");
+	Item* found = inventory.resolve(inventory.findHandle("EN3"));
+	report.expect(found != nullptr && found->getItemID() == "en3", "findHandle lowercases the ID like every other lookup");
+
+	string batchReport;
+	report.expect(inventory.runBatch("remove en3 cl4 nope gone\n", batchReport) == 1 && batchReport == "1: error removed 2 of 4, not found: nope gone\n" &&
+	              inventory.itemCount() == 0, "a batch remove with unknown IDs fails and names them: " + batchReport);
+	inventory.insertItem(CategoryTag::Clothing, "cl5", "Fifth", 5, Money::fromCents(500));
+	inventory.insertItem(CategoryTag::Clothing, "cl6", "Sixth", 6, Money::fromCents(600));
+	batchReport.clear();
+	report.expect(inventory.runBatch("remove cl5 CL6\n", batchReport) == 0 && batchReport == "1: ok removed 2\n", "a batch remove of known IDs succeeds: " + batchReport);
+}
+
+// Items that tie on the only sort key keep the same order whichever way the view is walked
+void checkSortTies(CheckReport& report) {
+	Inventory inventory;
+	inventory.insertItem(CategoryTag::Clothing, "cl1", "Same", 5, Money::fromCents(100));
+	inventory.insertItem(CategoryTag::Clothing, "cl2", "Same", 5, Money::fromCents(100));
+	inventory.insertItem(CategoryTag::Clothing, "cl3", "Same", 5, Money::fromCents(100));
+	inventory.insertItem(CategoryTag::Clothing, "cl4", "Other", 9, Money::fromCents(900));
+	auto ids = [](const vector<Item*>& items) {
+		string joined;
+		for (const Item* item : items) {
+			joined += item->getItemID() + " ";
+		}
+		return joined;
+	};
+	for (SortField field : {SortField::Quantity, SortField::Price}) {
+		string ascending = ids(inventory.sortedItems({{field, true}})), descending = ids(inventory.sortedItems({{field, false}}));
+		report.expect(ascending == "cl1 cl2 cl3 cl4 " && descending == "cl4 cl1 cl2 cl3 ", "ties keep their order in both directions: " + descending);
+	}
+	report.expect(ids(inventory.sortedItems({{SortField::Name, false}}, 2)) == "cl1 cl2 ", "a descending limit takes the first of the tied items");
+}
+
+// Behaviour checks of the paths that only fail on unusual input, the exit code is 1 when any fails
+int runSelfChecks() {
+	CheckReport report;
+	checkCategoryRegistry(report);
+	checkMoney(report);
+	checkCsvImport(report);
+	checkOperationLog(report);
+	checkSnapshots(report);
+	checkBatchParsing(report);
+	checkBulkRemoval(report);
+	checkSortTies(report);
+	printf("%zu check(s) passed, %zu failed\n", report.passed, report.failed);
+	return report.failed > 0 ? 1 : 0;
+}
+
+// Options:
+//   --scale <items>[,<items>...]  inventory sizes to benchmark, 1000,100000 unless given
+//   --filter <text>               runs only the benchmarks whose name contains the text
+//   --min-time <seconds>          shortest run that counts, 0.25 unless given
+//   --json <file>                 also writes the results as JSON
+//   --stress [items]              runs the multi-threaded stress test instead
+//   --valuation [rows]            checks and times the valuation scan over 10000000 rows unless given, instead
+//   --query [items]               checks and times sample queries over 1000000 items unless given, instead
+//   --topk [items]                checks and times the first 10, 100 and 1000 items of several orders over 1000000 items unless given, instead
+//   --check                       runs the behaviour self-checks instead
+int main(int argc, char* argv[]) {
+	vector<size_t> scales = {1000, 100000};
+	string filter, jsonPath;
+	double minSeconds = 0.25;
+	bool usageError = false;
+
+	for (int i = 1; i < argc && !usageError; i++) {
+		string option = argv[i];
+		bool hasValue = i + 1 < argc && string(argv[i + 1]).rfind("--", 0) != 0;
+
+		if (option == "--stress") {
+			size_t itemCount = 100000;
+			if (hasValue && (!parseNumber(string_view(argv[++i]), itemCount) || itemCount == 0)) {
+				cerr << "--stress expects a positive item count" << endl;
+				return 1;
+			}
+			return runStressTest(itemCount, 1.0);
+		} else if (option == "--valuation") {
+			size_t rowCount = 10000000;
+			if (hasValue && (!parseNumber(string_view(argv[++i]), rowCount) || rowCount == 0)) {
+				cerr << "--valuation expects a positive row count" << endl;
+				return 1;
+			}
+			return runValuationBenchmark(rowCount, minSeconds);
+		} else if (option == "--query") {
+			size_t itemCount = 1000000;
+			if (hasValue && (!parseNumber(string_view(argv[++i]), itemCount) || itemCount == 0)) {
+				cerr << "--query expects a positive item count" << endl;
+				return 1;
+			}
+			return runQueryBenchmark(itemCount, minSeconds);
+		} else if (option == "--topk") {
+			size_t itemCount = 1000000;
+			if (hasValue && (!parseNumber(string_view(argv[++i]), itemCount) || itemCount == 0)) {
+				cerr << "--topk expects a positive item count" << endl;
+				return 1;
+			}
+			return runTopKBenchmark(itemCount, minSeconds);
+		} else if (option == "--check") {
+			return runSelfChecks();
+		} else if (option == "--scale" && hasValue) {
+			scales.clear();
+			string_view list = argv[++i];
+			while (!usageError && !list.empty()) {
+				size_t comma = min(list.find(','), list.size());
+				size_t scale = 0;
+				usageError = !parseNumber(list.substr(0, comma), scale) || scale == 0;
+				scales.push_back(scale);
+				list.remove_prefix(min(comma + 1, list.size()));
+			}
+		} else if (option == "--filter" && hasValue) {
+			filter = argv[++i];
+		} else if (option == "--min-time" && hasValue) {
+			usageError = !parseNumber(string_view(argv[++i]), minSeconds) || !(minSeconds > 0);
+		} else if (option == "--json" && hasValue) {
+			jsonPath = argv[++i];
+		} else {
+			usageError = true;
+		}
+	}
+	if (usageError || scales.empty()) {
+		cerr << "Usage: " << argv[0] << " [--scale <items>[,<items>...]] [--filter <text>] [--min-time <seconds>] [--json <file>] [--stress [items]] [--valuation [rows]] [--query [items]] [--topk [items]] [--check]" << endl;
+		return 1;
+	}
+
+	vector<Benchmark> benchmarks = inventoryBenchmarks();
+	vector<BenchmarkResult> results;
+	printf("%-32s %12s %14s %16s %12s\n", "Benchmark", "Iterations", "ns/op", "Items/s", "Allocs/op");
+	for (size_t scale : scales) {
+		Fixture fixture;
+		fixture.items = generateItems(scale, static_cast<unsigned>(scale));
+		fixture.order.resize(scale);
+		for (size_t i = 0; i < scale; i++) {
+			fixture.order[i] = static_cast<uint32_t>(i);
+		}
+		shuffle(fixture.order.begin(), fixture.order.end(), mt19937(12345));
+		fillInventory(fixture.inventory, fixture.items);
+
+		for (const Benchmark& benchmark : benchmarks) {
+			if (string(benchmark.name).find(filter) == string::npos) {
+				continue;
+			}
+			results.push_back(runBenchmark(benchmark, fixture, scale, minSeconds));
+			const BenchmarkResult& result = results.back();
+			string name = result.name + "/" + to_string(scale);
+			printf("%-32s %12zu %14.1f %16.0f %12.2f\n", name.c_str(), result.iterations, result.nanosecondsPerOperation,
+			       result.itemsPerSecond, result.allocationsPerOperation);
+			fflush(stdout);
+		}
+	}
+	remove("inventory_bench.snap");
+	remove("inventory_bench.wal");
+
+	if (!jsonPath.empty() && !writeJson(jsonPath, results, minSeconds)) {
+		cerr << "Cannot write " << jsonPath << endl;
+		return 1;
+	}
+	return 0;
+}
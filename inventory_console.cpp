@@ -0,0 +1,915 @@
+#include "inventory_console.h"
+#include <iostream>
+#include <iomanip>
+#include <cctype>
+#include <limits>
+#include <vector>
+using namespace std;
+
+void TableRenderer::header() {
+	buffer += '\t';
+	appendCell("ID");
+	appendCell("Name");
+	appendCell("Quantity");
+	appendCell("Price");
+	appendCell("Category");
+	buffer += '\n';
+}
+
+// Adds one row, returns false once the reader declines the next page
+bool TableRenderer::row(string_view id, string_view name, int quantity, Money price, string_view category) {
+	if (stoppedPaging) {
+		return false;
+	}
+	if (pageSize > 0 && rowsOnPage == pageSize) {
+		flush();
+		if (InventoryConsole::validateYesNo("Show Next Page") != 'Y') {
+			stoppedPaging = true;
+			return false;
+		}
+		header();
+		rowsOnPage = 0;
+	}
+
+	char quantityText[16], priceText[Money::maxFormattedLength];
+	string_view quantityCell(quantityText, to_chars(quantityText, quantityText + sizeof(quantityText), quantity).ptr - quantityText);
+	string_view priceCell(priceText, price.format(priceText, priceText + sizeof(priceText)) - priceText);
+	auto cellWidth = [](string_view text) {
+		return text.size() > columnWidth ? text.size() : columnWidth;
+	};
+	size_t start = buffer.size();
+	buffer.resize(start + 2 + cellWidth(id) + columnWidth + 3 + cellWidth(quantityCell) + cellWidth(priceCell) + cellWidth(category));
+	char* out = &buffer[start];
+	*out++ = '\t';
+	out = writeCell(out, id);
+	if (name.length() > 18 - 3) {
+		memcpy(out, name.data(), 18 - 3); // Replace long item name
+		memcpy(out + 18 - 3, "...", 3);
+		out += 18;
+	} else {
+		out = writeCell(out, name);
+	}
+	out = writeCell(out, quantityCell);
+	out = writeCell(out, priceCell);
+	out = writeCell(out, category);
+	*out++ = '\n';
+	buffer.resize(static_cast<size_t>(out - buffer.data()));
+
+	rowsOnPage++;
+	if (buffer.size() >= flushThreshold) {
+		flush();
+	}
+	return true;
+}
+
+void TableRenderer::line(string_view text) {
+	buffer += text;
+	buffer += '\n';
+}
+
+void TableRenderer::flush() {
+	if (!buffer.empty()) {
+		fwrite(buffer.data(), 1, buffer.size(), output);
+		fflush(output);
+		buffer.clear();
+	}
+}
+
+char InventoryConsole::validateYesNo(const string& prompt) {
+	char choice;
+	bool validInput;
+	
+	do {
+		cout << prompt << " [Y/N]: ";
+		cin >> choice;
+		cout << endl;
+		
+		// Check if input is a single character
+        if (cin.fail() || cin.peek() != '\n') {
+            cin.clear(); // Clear the fail state
+            cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Ignore remaining input
+            validInput = false; // Invalid input
+            cout << "\tInvalid input! Please enter only 1 letter (Y or N)." << endl << endl;
+            continue; // Ask for input again
+        }
+        
+		choice = toupper(choice);
+		
+		if (choice == 'Y' || choice == 'N') {
+			validInput = true;
+			cin.ignore();
+		} else {
+			validInput = false;
+			cout << "\tInvalid choice! Please enter Y or N." << endl << endl;
+		}
+	} while (!validInput);
+	return choice;
+}
+
+// Makes the last change durable, or says why it is not yet
+void InventoryConsole::commitChanges() {
+	string error;
+	if (!inventory.commitChanges(error)) {
+		cout << "\tWarning: the change is not saved to disk yet, it is retried with the next change. " << error << endl;
+	}
+}
+
+// Menu Options
+void InventoryConsole::addItem() {
+	string categoryChoice, name, alphaNumericIDInput, quantityInput, priceInput;
+	int quantity = 0;
+	Money price;
+
+	do {
+		cout << "Enter the new item information." << endl << endl;
+		
+		// Input category
+		CategoryTag tag = promptCategory();
+		categoryChoice = Inventory::getCategoryCode(tag);
+
+		// Input id
+		string id;
+		bool validID = false;
+		do {
+			cout << "\tID: ";
+			getline(cin, alphaNumericIDInput); 
+			
+			if (!Inventory::isValidID(alphaNumericIDInput)) {
+				cout << "\tInvalid input. Please enter alphanumeric characters and avoid space." << endl << endl;
+				continue;
+			}
+
+			id = categoryChoice + alphaNumericIDInput;
+			toLowerCase(id); // Index keys are lowercase
+			if (inventory.getItem(id) != nullptr) {
+				cout << "\tThis ID is already taken. Please choose another." << endl;
+			} else {
+				validID = true;
+			}
+		} while (!validID);
+		
+		cout << "\tOfficial ID: " << id << endl;
+		
+		// Input name
+		do {
+			cout << "\tName: ";
+			getline(cin, name);
+			
+			if (name.empty()) {
+				cout << "\tInvalid input. Avoid space and enter a valid name." << endl << endl;
+			} else {
+				name = Inventory::capitalizeFirstLetter(name);
+			}
+		} while (name.empty());
+
+		// Input quantity
+		do {
+			cout << "\tQuantity: ";
+			getline(cin, quantityInput);
+			
+			if (quantityInput.empty() || !Inventory::isAllDigits(quantityInput)) {
+		        cout << "\tInvalid input. Please enter a numeric value and/or avoid space." << endl << endl;
+		        continue;
+		    } else {
+				try { // Handle the exceptions due to stoi
+					quantity = stoi(quantityInput);
+					if (quantity <= 0) {
+						cout << "\tInvalid input. Please enter a positive quantity" << endl << endl;
+					} else {
+						break;
+					}
+				} catch (invalid_argument&) { // Handle invalid numeric conversion
+	        		cout << "\tInvalid input. Please enter a numeric value and/or avoid space." << endl << endl;
+				} catch (out_of_range&) { // Handle very large number
+					cout << "\tInput is out of range. Please enter a smaller number." << endl << endl;
+ 				}
+			}
+		} while (quantityInput.empty() || !Inventory::isAllDigits(quantityInput) || quantity <= 0);
+
+		// Input price, whole cents only
+		do {
+			cout << "\tPrice: ";
+			getline(cin, priceInput);
+			if (!Money::parse(priceInput, price)) {
+				cout << "\tInvalid input. Please enter a price with at most two decimals and/or avoid space." << endl << endl;
+				continue;
+			}
+			if (price <= Money()) {
+				cout << "\tInvalid input. Please enter a positive price" << endl << endl;
+				continue;
+			}
+			if (!price.isValidPrice()) {
+				cout << "\tInvalid input. Please enter a price up to " << Money::fromCents(Money::maxPriceCents).toString() << endl << endl;
+				continue;
+			}
+			break;
+		} while (true);
+
+		// Create the item and add it to storage after gathering all inputs
+		if (inventory.insertItem(tag, id, name, quantity, price)) {
+			commitChanges();
+			cout << "\tItem added successfully!" << endl << endl;
+		} else {
+			cout << "\tItem could not be added. The ID may have been taken meanwhile." << endl << endl;
+		}
+	} while (validateYesNo("Add Another Item") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::updateItem() {
+	string id, updateChoice, quantityInput, priceInput;
+	char updateChar = 0;
+	int newQuantity = 0;
+	Money newPrice;
+	bool itemFound = false;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to update." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		itemFound = false;
+		cout << "Enter the ID, what to update and its new value." << endl << endl;
+		
+		do {
+			cout << "\tID: ";
+			getline(cin, id); 
+			cout << endl;
+			
+			if (!Inventory::isValidID(id)) {
+				cout << "\tInvalid input. Please enter alphanumeric characters and/or avoid space." << endl << endl;
+			}
+		} while (!Inventory::isValidID(id));
+		
+		toLowerCase(id);
+
+		// Look up the item through the ID index
+		const Item* item = inventory.getItem(id);
+		if (item != nullptr) {
+			itemFound = true;
+
+			cout << "\tCurrent Details of the Item" << endl;
+			printItemDetails(item);
+			cout << endl << endl;
+
+			// Ask what to update
+			cout << "\tQ - Quantity\n\tP - Price\n\tR - Reorder Level" << endl;
+			do {
+				cout << "\tWhat to update: ";
+				getline(cin, updateChoice);
+				
+				if (updateChoice.length() > 1) {
+					cout << "\tInvalid input! Please enter only 1 letter (Q, P, or R)." << endl << endl;
+				} else {
+					updateChoice[0] = toupper(updateChoice[0]);
+					updateChar = updateChoice[0];
+					
+					if (updateChoice != "Q" && updateChoice != "P" && updateChoice != "R") {
+					cout << "\tInvalid choice! Please enter Q for Quantity, P for Price or R for Reorder Level." << endl << endl;
+					}
+				}
+			} while (updateChoice.length() != 1 || (updateChoice != "Q" && updateChoice != "P" && updateChoice != "R"));
+			
+			switch(updateChar) {
+				case 'Q': {
+					const int oldQuantity = item->getItemQuantity(); // Getter
+					
+					do {
+						cout << "\tNew Quantity: ";
+						getline(cin, quantityInput);
+						
+						if (quantityInput.empty() || !Inventory::isAllDigits(quantityInput)) {
+							cout << "\tInvalid input. Please enter a positive whole number and/or avoid space." << endl << endl;
+						} else {
+							try {
+								newQuantity = stoi(quantityInput);
+								
+								if (newQuantity == oldQuantity) {
+									cout << "\tYou entered the same amount. Please enter a different value." << endl << endl;
+								} else {
+									inventory.updateQuantity(id, newQuantity);
+									commitChanges();
+									cout << "\tQuantity of Item " << item->getItemName() << " is updated from " << oldQuantity << " to " << newQuantity << endl << endl;
+									break;
+								} 
+							} catch (invalid_argument&) {
+					            cout << "\tInvalid input. Please enter a numeric value and/or avoid space." << endl << endl;
+					        } catch (out_of_range&) {
+					            cout << "\tInput is out of range. Please enter a smaller number." << endl << endl;
+					        }
+						}
+					} while (quantityInput.empty() || !Inventory::isAllDigits(quantityInput) || newQuantity == oldQuantity); 
+					break;
+				}
+				case 'P': {
+					const Money oldPrice = item->getItemPrice();
+					
+					do {
+						cout << "\tNew Price: ";
+						getline(cin, priceInput);
+						if (!Money::parse(priceInput, newPrice)) {
+							cout << "\tInvalid input. Please enter a price with at most two decimals and/or avoid space." << endl << endl;
+						} else if (newPrice == oldPrice) {
+							cout << "\tYou entered the same amount. Please enter a different value." << endl << endl;
+						} else if (newPrice <= Money()) {
+							cout << "\tInvalid input. Please enter a positive price" << endl << endl;
+						} else if (!newPrice.isValidPrice()) {
+							cout << "\tInvalid input. Please enter a price up to " << Money::fromCents(Money::maxPriceCents).toString() << endl << endl;
+						} else {
+							inventory.updatePrice(id, newPrice);
+							commitChanges();
+							cout << "\tPrice of Item " << item->getItemName() << " is updated from " << oldPrice.toString() << " to " << newPrice.toString() << endl << endl;
+							break;
+						}
+					} while (true);
+					break;
+				}
+				case 'R': {
+					string levelInput;
+					const int categoryLevel = inventory.getCategoryReorderLevel(Inventory::getCategoryTag(item));
+					
+					cout << "\tCurrent Reorder Level: " << inventory.getReorderLevel(item) << endl;
+					do {
+						cout << "\tNew Reorder Level (blank for the category level of " << categoryLevel << "): ";
+						getline(cin, levelInput);
+						
+						if (!levelInput.empty() && (!Inventory::isAllDigits(levelInput) || levelInput.size() > 9)) {
+							cout << "\tInvalid input. Please enter a whole number and/or avoid space." << endl << endl;
+						}
+					} while (!levelInput.empty() && (!Inventory::isAllDigits(levelInput) || levelInput.size() > 9));
+
+					inventory.updateReorderLevel(id, levelInput.empty() ? Inventory::useCategoryReorderLevel : stoi(levelInput));
+					commitChanges();
+					cout << "\tReorder Level of Item " << item->getItemName() << " is now " << inventory.getReorderLevel(item) << endl << endl;
+					break;
+				}
+				default:
+					cout << "\tInvalid choice!" << endl;
+					break;
+			}
+		}
+		if (!itemFound) {
+			cout << "\tItem not found!" << endl << endl;
+		}
+	} while (validateYesNo("Update Another Item") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::removeItem() {
+	string id;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to remove." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		cout << "Enter the ID of the item to remove." << endl << endl;
+		do {
+			cout << "\tID: ";
+			getline(cin, id); 
+			cout << endl;
+			
+			if (!Inventory::isValidID(id)) {
+				cout << "\tInvalid input. Please enter alphanumeric characters and/or avoid space." << endl << endl;
+			}
+		} while (!Inventory::isValidID(id));
+
+		toLowerCase(id);
+
+		// Remove the item from storage and every index, then free it
+		if (inventory.eraseItem(id)) {
+			commitChanges();
+			cout << "\tItem " << id << " has been removed from the inventory." << endl << endl;
+			system("pause");
+			return;
+		}
+		cout << "\tItem not found!" << endl << endl;
+
+	} while (validateYesNo("Remove Another Item") == 'Y');
+}
+
+void InventoryConsole::displayByCategory() {
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to display." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		cout << "Enter the category code to display." << endl << endl; 
+	
+		// Input category
+		CategoryTag tag = promptCategory();
+		vector<Item*> items = inventory.itemsInCategory(tag);
+
+		if (items.empty()) {
+			cout << "\tNo items found in the " << Inventory::getCategoryName(tag) << " Category." << endl << endl; 
+		} else {
+			// Print header
+			TableRenderer table(TableRenderer::defaultPageSize);
+			table.header();
+
+			// Only this category's items
+			for (const Item* item : items) { 
+				// Display item details in a table row
+				if (!displayItemDetails(table, item)) {
+					break;
+				}
+			}
+			table.line("");
+			table.flush();
+
+			// Totals are kept up to date, no scan needed
+			const CategoryStats& stats = inventory.getCategoryStats(tag);
+			cout << "\tItems: " << stats.itemCount
+			     << "\tTotal Quantity: " << stats.totalQuantity
+			     << "\tStock Value: " << stats.totalValue.toString() << endl << endl;
+		}
+
+	} while (validateYesNo("Display Another Category") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::displayAllItems() {
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to display." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	// Print header
+	TableRenderer table(TableRenderer::defaultPageSize);
+	table.header();
+
+	// Separate sections for each category
+	for (const CategoryInfo& info : categoryTable) {
+		for (const Item* item : inventory.itemsInCategory(info.tag)) {
+			if (!displayItemDetails(table, item)) {
+				break;
+			}
+		}
+	}
+
+	table.line("");
+	table.flush();
+	system("pause");
+}
+
+// One item as a table row, false once the reader stops paging
+bool InventoryConsole::displayItemDetails(TableRenderer& table, const Item* item) {
+	return table.row(item->getItemID(), item->getItemName(), item->getItemQuantity(), item->getItemPrice(), item->getItemCategory());
+}
+
+// One item as a list of fields, for the ID lookups
+void InventoryConsole::printItemDetails(const Item* item) {
+	cout << "\t\tID: " << item->getItemID() << endl;
+	cout << "\t\tName: " << item->getItemName() << endl;
+	cout << "\t\tQuantity: " << item->getItemQuantity() << endl;
+	cout << "\t\tPrice: " << item->getItemPrice().toString() << endl;
+	cout << "\t\tCategory: " << item->getItemCategory();
+}
+
+// Full dump without paging, used by --list
+void InventoryConsole::listAllItems(FILE* output) const {
+	TableRenderer table(0, output);
+	table.header();
+	inventory.visitRows([&table](string_view id, string_view name, int quantity, Money price, CategoryTag tag) {
+		return table.row(id, name, quantity, price, Inventory::getCategoryName(tag));
+	});
+}
+
+void InventoryConsole::searchItem() {
+	string searchChoice, searchTerm;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to search." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		cout << "Search by ID or by name." << endl << endl;
+		cout << "\tI - ID\n\tN - Name" << endl;
+		do {
+			cout << "\tSearch By: ";
+			getline(cin, searchChoice);
+			
+			if (searchChoice.length() != 1) {
+				cout << "\tInvalid input! Please enter only 1 letter (I or N)." << endl << endl;
+			} else {
+				searchChoice[0] = toupper(searchChoice[0]);
+				if (searchChoice != "I" && searchChoice != "N") {
+					cout << "\tInvalid choice! Please enter I for ID or N for Name." << endl << endl;
+				}
+			}
+		} while (searchChoice != "I" && searchChoice != "N");
+		cout << endl;
+
+		if (searchChoice == "I") {
+			do {
+				cout << "\tID: ";
+				getline(cin, searchTerm); 
+				cout << endl;
+				
+				if (!Inventory::isValidID(searchTerm)) {
+					cout << "\tInvalid input. Please enter alphanumeric characters and/or avoid space." << endl << endl;
+				}
+			} while (!Inventory::isValidID(searchTerm));
+
+			bool found = false;
+
+			const Item* item = inventory.getItem(searchTerm);
+			if (item != nullptr) {
+				found = true;
+				cout << "\tCurrent Details of the Item" << endl;
+				printItemDetails(item);
+				cout << endl << endl;
+			}
+			if (!found) {
+				cout << "\tItem not found!" << endl << endl;
+			}
+		} else {
+			do {
+				cout << "\tName (or part of it): ";
+				getline(cin, searchTerm);
+				cout << endl;
+				
+				if (searchTerm.empty()) {
+					cout << "\tInvalid input. Please enter at least one character." << endl << endl;
+				}
+			} while (searchTerm.empty());
+
+			// Best matches first, limited to one page
+			size_t matchCount = 0;
+			vector<Item*> matches = inventory.searchNames(searchTerm, Inventory::nameSearchLimit, &matchCount);
+			if (matches.empty()) {
+				cout << "\tNo item names contain \"" << searchTerm << "\"." << endl << endl;
+			} else {
+				TableRenderer table;
+				table.header();
+				for (const Item* item : matches) {
+					displayItemDetails(table, item);
+				}
+				table.flush();
+				cout << endl << "\tShowing " << matches.size() << " of " << matchCount << " match(es)." << endl << endl;
+			}
+		}
+
+	} while (validateYesNo("Search Another Item") == 'Y');
+	system("pause");
+}
+				
+void InventoryConsole::sortItems() {
+	string sortChoice, orderChoice;
+	vector<SortKey> keys;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to sort" << endl << endl;
+	    system("pause");
+	    return;
+	}
+	
+	do {
+		keys.clear();
+		
+		// Each key is applied in order, later keys only break ties of earlier ones
+		do {
+			cout << "Enter the letter to sort the list accordingly." << endl << endl;
+			cout << "\tQ - Quantity\n\tP - Price\n\tN - Name\n\tI - ID\n\tC - Category\n\tV - Stock Value" << endl;
+			do {
+				cout << "\tSort By: ";
+				getline(cin, sortChoice);
+				cout << endl;
+				
+				if (sortChoice.length() != 1) {
+					cout << "\tInvalid input! Please enter only 1 letter (Q, P, N, I, C or V)." << endl << endl;
+				} else {
+					sortChoice[0] = toupper(sortChoice[0]);
+
+					if (!Inventory::parseSortField(sortChoice[0])) {
+						cout << "\tInvalid choice! Please enter Q, P, N, I, C or V." << endl << endl;
+					}
+				}
+			} while (sortChoice.length() != 1 || !Inventory::parseSortField(sortChoice[0]));
+			
+			// Sort by ascending or descending
+			cout << "Select order." << endl << endl;
+			cout << "\tA - Ascending\n\tD - Descending" << endl;
+			do {
+				cout << "\tArranged By: ";
+				getline(cin, orderChoice);
+				cout << endl;
+				
+				if (orderChoice.length() != 1) {
+					cout << "\tInvalid input! Please enter only 1 letter (A or D)." << endl << endl;
+				} else {
+					orderChoice[0] = toupper(orderChoice[0]);
+
+					if(orderChoice != "A" && orderChoice != "D") {
+						cout << "\tInvalid choice! Please enter A for Ascending or D for Descending." << endl << endl;
+					}
+				}
+			} while (orderChoice.length() != 1 || (orderChoice != "A" && orderChoice != "D"));
+			
+			SortField field = SortField::Quantity;
+			Inventory::parseSortField(sortChoice[0], &field);
+			keys.push_back({field, orderChoice == "A"});
+		} while (validateYesNo("Add Another Sort Key") == 'Y');
+
+		// Display table header
+		TableRenderer table(TableRenderer::defaultPageSize);
+		table.header();
+
+		// Most readers stop after the first page, so only the rows about to be shown are selected, more as paging goes on
+		size_t shown = 0, wanted = TableRenderer::defaultPageSize;
+		while (true) {
+			vector<Item*> sorted = inventory.sortedItems(keys, wanted);
+			for (; shown < sorted.size() && displayItemDetails(table, sorted[shown]); shown++) {}
+			if (table.stopped() || sorted.size() < wanted) {
+				break;
+			}
+			wanted *= 8;
+		}
+		table.line("");
+		table.flush();
+	} while (validateYesNo("Sort Again") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::displayLowStock() {
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to display." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	cout << "Items at or below their reorder level (";
+	for (size_t i = 0; i < categoryCount; i++) {
+		cout << (i > 0 ? ", " : "") << categoryTable[i].name << " " << inventory.getCategoryReorderLevel(categoryTable[i].tag);
+	}
+	cout << ")." << endl << endl;
+	// Print header
+	TableRenderer table(TableRenderer::defaultPageSize);
+	table.header();
+
+	// Only the items already known to be low are visited
+	vector<Item*> lowItems = inventory.lowStockItems();
+	for (const Item* item : lowItems) {
+		if (!displayItemDetails(table, item)) {
+			break;
+		}
+	}
+	table.flush();
+	if (lowItems.empty()) {
+		cout << "\n\tNo items with low stock." << endl; 
+	}
+	cout << endl;
+	system("pause");
+}
+
+void InventoryConsole::displayByRange() {
+	string rangeChoice, minInput, maxInput;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to display." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		cout << "Enter the field and the range to display." << endl << endl;
+		cout << "\tQ - Quantity\n\tP - Price" << endl;
+		do {
+			cout << "\tRange Of: ";
+			getline(cin, rangeChoice);
+			
+			if (rangeChoice.length() != 1) {
+				cout << "\tInvalid input! Please enter only 1 letter (Q or P)." << endl << endl;
+			} else {
+				rangeChoice[0] = toupper(rangeChoice[0]);
+				
+				if (rangeChoice != "Q" && rangeChoice != "P") {
+					cout << "\tInvalid choice! Please enter Q for Quantity or P for Price." << endl << endl;
+				}
+			}
+		} while (rangeChoice.length() != 1 || (rangeChoice != "Q" && rangeChoice != "P"));
+		
+		bool byQuantity = rangeChoice == "Q";
+		double minQuantity = 0, maxQuantity = 0;
+		Money minPrice, maxPrice;
+		
+		// Input both bounds, quantities must be whole numbers and prices whole cents
+		do {
+			cout << "\tFrom: ";
+			getline(cin, minInput);
+			cout << "\tTo: ";
+			getline(cin, maxInput);
+			
+			bool validBounds = byQuantity
+				? !minInput.empty() && !maxInput.empty() && Inventory::isAllDigits(minInput) && Inventory::isAllDigits(maxInput)
+				: Money::parse(minInput, minPrice) && Money::parse(maxInput, maxPrice);
+			if (!validBounds) {
+				cout << "\tInvalid input. Please enter a numeric value and/or avoid space." << endl << endl;
+				continue;
+			}
+			
+			try {
+				if (byQuantity) {
+					minQuantity = stod(minInput);
+					maxQuantity = stod(maxInput);
+				}
+				if (byQuantity ? minQuantity > maxQuantity : minPrice > maxPrice) {
+					cout << "\tInvalid range. The first value must not be greater than the second." << endl << endl;
+					continue;
+				}
+				break;
+			} catch (out_of_range&) {
+				cout << "\tInput is out of range. Please enter a smaller number." << endl << endl;
+			}
+		} while (true);
+		cout << endl;
+		
+		vector<Item*> matches = byQuantity
+			? inventory.itemsInQuantityRange(static_cast<int>(min<double>(minQuantity, numeric_limits<int>::max())), static_cast<int>(min<double>(maxQuantity, numeric_limits<int>::max())))
+			: inventory.itemsInPriceRange(minPrice, maxPrice);
+		
+		if (matches.empty()) {
+			cout << "\tNo items found in the given range." << endl << endl;
+		} else {
+			// Print header
+			TableRenderer table(TableRenderer::defaultPageSize);
+			table.header();
+			
+			for (Item* item : matches) {
+				if (!displayItemDetails(table, item)) {
+					break;
+				}
+			}
+			table.line("");
+			table.flush();
+		}
+	} while (validateYesNo("Display Another Range") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::queryItems() {
+	string text, error;
+
+	if (inventory.itemCount() == 0) {
+		cout << "\tNo items in the inventory. Nothing to query." << endl << endl;
+	    system("pause");
+	    return;
+	}
+
+	do {
+		cout << "Enter conditions on id, name, category, quantity, price or value (stock value) joined by AND, then ORDER BY and LIMIT if needed." << endl;
+		cout << "\tExample: category=el AND price<100 AND quantity BETWEEN 1 AND 10 ORDER BY price DESC LIMIT 20" << endl << endl;
+
+		ItemQuery query;
+		do {
+			cout << "\tQuery: ";
+			getline(cin, text);
+			cout << endl;
+
+			if (!Inventory::parseQuery(text, query, error)) {
+				cout << "\tInvalid query: " << error << "." << endl << endl;
+				continue;
+			}
+			break;
+		} while (true);
+
+		QueryResult result = inventory.runQuery(query);
+		if (result.items.empty()) {
+			cout << "\tNo items match the query." << endl << endl;
+		} else {
+			TableRenderer table(TableRenderer::defaultPageSize);
+			table.header();
+			for (const Item* item : result.items) {
+				if (!displayItemDetails(table, item)) {
+					break;
+				}
+			}
+			table.line("");
+			table.flush();
+			cout << "\t" << result.items.size() << " item(s) found by " << Inventory::getQueryAccessName(result.access)
+			     << ", " << result.examined << " examined." << endl << endl;
+		}
+	} while (validateYesNo("Run Another Query") == 'Y');
+	system("pause");
+}
+
+void InventoryConsole::displayStatistics() {
+	MetricsReport report = inventory.metricsReport();
+	ios_base::fmtflags flags = cout.flags();
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(1);
+
+	if (!report.enabled) {
+		cout << "\tOperation metrics were left out of this build." << endl << endl;
+	} else if (report.operations.empty()) {
+		cout << "\tNo operations recorded yet." << endl << endl;
+	} else {
+		// Latencies come from sampled calls, lookups and adjustments time one call in OperationMetrics::hotSampleInterval
+		cout << "\t" << left << setw(18) << "Operation" << right << setw(10) << "Calls" << setw(12) << "Mean (us)"
+		     << setw(12) << "p50 (us)" << setw(12) << "p99 (us)" << setw(12) << "p99.9 (us)" << setw(12) << "Max (us)" << endl;
+		for (const OperationReport& operation : report.operations) {
+			cout << "\t" << left << setw(18) << operation.name << right << setw(10) << operation.calls;
+			if (operation.sampled == 0) {
+				cout << setw(12) << "-" << setw(12) << "-" << setw(12) << "-" << setw(12) << "-" << setw(12) << "-" << endl;
+				continue; // Too few calls to have timed one yet
+			}
+			cout << setw(12) << operation.mean / 1000 << setw(12) << operation.p50 / 1000.0 << setw(12) << operation.p99 / 1000.0
+			     << setw(12) << operation.p999 / 1000.0 << setw(12) << operation.max / 1000.0 << endl;
+		}
+		cout << endl;
+	}
+
+	size_t totalItems = 0;
+	uint64_t totalMemory = 0;
+	cout << "\t" << left << setw(18) << "Category" << right << setw(10) << "Items" << setw(16) << "Memory (KB)" << endl;
+	for (const CategoryReport& category : report.categories) {
+		cout << "\t" << left << setw(18) << category.name << right << setw(10) << category.itemCount << setw(16) << category.memoryBytes / 1024.0 << endl;
+		totalItems += category.itemCount;
+		totalMemory += category.memoryBytes;
+	}
+	cout << "\t" << left << setw(18) << "Total" << right << setw(10) << totalItems << setw(16) << totalMemory / 1024.0 << endl << endl;
+
+	// Stock value and price spread from a fresh scan of every item
+	InventoryValuation valuation = inventory.valuation();
+	cout << "\t" << left << setw(18) << "Category" << right << setw(10) << "Items" << setw(12) << "Quantity" << setw(16) << "Stock Value"
+	     << setw(12) << "Min Price" << setw(12) << "Avg Price" << setw(12) << "Max Price" << endl;
+	for (size_t i = 0; i <= categoryCount; i++) {
+		const ValuationTotals& totals = i < categoryCount ? valuation.categories[i] : valuation.overall;
+		cout << "\t" << left << setw(18) << (i < categoryCount ? categoryTable[i].name : "Total") << right << setw(10) << totals.itemCount
+		     << setw(12) << totals.totalQuantity << setw(16) << totals.totalValue.toString() << setw(12) << totals.minPrice.toString()
+		     << setw(12) << totals.averagePrice().toString() << setw(12) << totals.maxPrice.toString() << endl;
+	}
+	cout << endl;
+	cout.flags(flags);
+	cout.precision(precision);
+
+	if (validateYesNo("Save Metrics Files") == 'Y') {
+		string error;
+		for (const char* path : {"inventory_metrics.json", "inventory_metrics.prom"}) {
+			if (saveMetrics(path, report, error)) {
+				cout << "\tMetrics written to " << path << endl;
+			} else {
+				cout << "\t" << error << endl;
+			}
+		}
+		cout << endl;
+	}
+	system("pause");
+}
+
+// Uppercase codes for messages, e.g. "CL, EL, or EN"
+string InventoryConsole::categoryCodeList() {
+	string list;
+	for (size_t i = 0; i < categoryCount; i++) {
+		if (i > 0) {
+			list += i + 1 == categoryCount ? ", or " : ", ";
+		}
+		for (const char* c = categoryTable[i].code; *c != '\0'; c++) {
+			list += static_cast<char>(toupper(*c));
+		}
+	}
+	return list;
+}
+
+// Lists every category and asks until a valid code is entered
+CategoryTag InventoryConsole::promptCategory() {
+	string categoryChoice;
+	CategoryTag tag = CategoryTag::Clothing;
+
+	for (const CategoryInfo& info : categoryTable) {
+		string code = info.code;
+		for (char& c : code) {
+			c = toupper(c);
+		}
+		cout << "\t" << code << " - " << info.name << endl;
+	}
+	
+	// Input category
+	do {
+	    cout << "\tCategory: ";
+	    getline(cin, categoryChoice);
+	    
+	    if (categoryChoice.length() > 2) {
+	        cout << "\tInvalid input! Please enter exactly two letters (" << categoryCodeList() << ")." << endl;
+	    } else {
+	        for (char& c : categoryChoice) {
+	            c = tolower(c);
+    		}		
+
+	        if (!Inventory::parseCategoryCode(categoryChoice, tag)) {
+	            cout << "\tCategory " << categoryChoice << " does not exist! Please enter " << categoryCodeList() << "." << endl;
+	        }
+	    }
+	    cout << endl;
+	} while (categoryChoice.length() != 2 || !Inventory::parseCategoryCode(categoryChoice, tag));
+	return tag;
+}
@@ -0,0 +1,92 @@
+// Console front-end of the inventory: prompts, paged tables and the menu actions
+#ifndef INVENTORY_CONSOLE_H
+#define INVENTORY_CONSOLE_H
+
+#include "inventory.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+using namespace std;
+
+class TableRenderer;
+
+// Console front-end, every prompt and table lives here and the inventory only answers queries and applies changes
+class InventoryConsole {
+	private:
+		Inventory& inventory;
+
+		static void printItemDetails(const Item* item);
+		static bool displayItemDetails(TableRenderer& table, const Item* item);
+		static string categoryCodeList();
+		static CategoryTag promptCategory();
+		void commitChanges();
+
+	public:
+		explicit InventoryConsole(Inventory& target) : inventory(target) {}
+
+		static char validateYesNo(const string& prompt);
+
+		void addItem();
+		void updateItem();
+		void removeItem();
+		void displayByCategory();
+		void displayAllItems();
+		void searchItem();
+		void sortItems();
+		void displayLowStock();
+		void displayByRange();
+		void displayStatistics();
+		void queryItems();
+		void listAllItems(FILE* output) const;
+};
+
+// Formats table rows into one large buffer with to_chars and writes it out in big blocks
+class TableRenderer {
+	private:
+		static const size_t columnWidth = 15;
+		static const size_t flushThreshold = 1 << 20;
+
+		FILE* output;
+		string buffer;
+		size_t pageSize; // 0 shows every row
+		size_t rowsOnPage = 0;
+		bool stoppedPaging = false;
+
+		void appendCell(string_view text) {
+			buffer += text;
+			if (text.size() < columnWidth) {
+				buffer.append(columnWidth - text.size(), ' ');
+			}
+		}
+		// Rows are written in place behind one resize, appending cell by cell costs a capacity check and a call per piece
+		static char* writeCell(char* out, string_view text) {
+			memcpy(out, text.data(), text.size());
+			out += text.size();
+			if (text.size() < columnWidth) {
+				memset(out, ' ', columnWidth - text.size());
+				out += columnWidth - text.size();
+			}
+			return out;
+		}
+
+	public:
+		static const size_t defaultPageSize = 50;
+
+		explicit TableRenderer(size_t rowsPerPage = 0, FILE* out = stdout) : output(out), pageSize(rowsPerPage) {
+			buffer.reserve(flushThreshold + 256);
+		}
+		~TableRenderer() {
+			flush();
+		}
+
+		void header();
+		bool row(string_view id, string_view name, int quantity, Money price, string_view category);
+		void line(string_view text);
+		void flush();
+		bool stopped() const {
+			return stoppedPaging;
+		}
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "inventory_metrics.h"
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+
+const char* getMetricOperationName(MetricOperation operation) {
+	static const char* names[metricOperationCount] = {
+		"insert", "lookup", "update", "adjust", "remove", "search", "sort", "category_listing", "low_stock", "range",
+		"query", "valuation", "snapshot_save", "snapshot_load", "import", "export", "batch"
+	};
+	return names[static_cast<size_t>(operation)];
+}
+
+// Values below 16 get a bucket each, above that the top five bits pick the bucket
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds) {
+	if (nanoseconds < subBucketCount) {
+		return static_cast<size_t>(nanoseconds);
+	}
+	unsigned highestBit = 63;
+	while ((nanoseconds >> highestBit) == 0) {
+		highestBit--;
+	}
+	unsigned shift = highestBit - subBucketBits;
+	return (shift + 1) * subBucketCount + ((nanoseconds >> shift) & (subBucketCount - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+	size_t group = bucket / subBucketCount;
+	uint64_t subBucket = bucket % subBucketCount;
+	if (group == 0) {
+		return subBucket;
+	}
+	unsigned shift = static_cast<unsigned>(group - 1);
+	return ((subBucketCount + subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+	buckets[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+	sampleCount.fetch_add(1, memory_order_relaxed);
+	totalNanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+	uint64_t highest = maximum.load(memory_order_relaxed);
+	while (nanoseconds > highest && !maximum.compare_exchange_weak(highest, nanoseconds, memory_order_relaxed)) {}
+}
+
+double LatencyHistogram::mean() const {
+	uint64_t samples = count();
+	return samples > 0 ? static_cast<double>(totalNanoseconds.load(memory_order_relaxed)) / samples : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+	uint64_t samples = count();
+	if (samples == 0) {
+		return 0;
+	}
+	uint64_t wanted = static_cast<uint64_t>(fraction * samples + 0.5);
+	wanted = wanted < 1 ? 1 : wanted;
+	uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+		seen += buckets[bucket].load(memory_order_relaxed);
+		if (seen >= wanted) {
+			uint64_t bound = bucketUpperBound(bucket);
+			return bound < max() ? bound : max();
+		}
+	}
+	return max();
+}
+
+// Rows are leased per thread for the whole process, a row freed by an exiting thread goes to the next new thread
+// The lease mutex orders the old owner's last adds before the new owner's first
+size_t OperationMetrics::leaseRow() {
+	static mutex leaseMutex;
+	static vector<size_t> freeRows;
+	static size_t nextRow = 0;
+	struct Lease {
+		size_t row;
+		Lease() {
+			lock_guard<mutex> lock(leaseMutex);
+			if (!freeRows.empty()) {
+				row = freeRows.back();
+				freeRows.pop_back();
+			} else {
+				row = nextRow < ownedRows ? nextRow++ : ownedRows;
+			}
+		}
+		~Lease() {
+			if (row < ownedRows) {
+				lock_guard<mutex> lock(leaseMutex);
+				freeRows.push_back(row);
+			}
+		}
+	};
+	static thread_local Lease lease;
+	leasedRow = lease.row;
+	return leasedRow;
+}
+
+uint64_t OperationMetrics::calls(MetricOperation operation) const {
+	uint64_t total = 0;
+	for (const CounterRow& row : rows) {
+		total += row.calls[static_cast<size_t>(operation)].load(memory_order_relaxed);
+	}
+	return total;
+}
+
+// Numbers go through printf so the output never depends on stream state
+static void appendFormatted(string& output, const char* format, ...) {
+	char buffer[256];
+	va_list arguments;
+	va_start(arguments, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+	va_end(arguments);
+	if (length > 0) {
+		output.append(buffer, static_cast<size_t>(length) < sizeof(buffer) ? length : sizeof(buffer) - 1);
+	}
+}
+
+string metricsToJson(const MetricsReport& report) {
+	string json = "{\n  \"metrics_enabled\": ";
+	json += report.enabled ? "true" : "false";
+	json += ",\n  \"operations\": [";
+	for (size_t i = 0; i < report.operations.size(); i++) {
+		const OperationReport& operation = report.operations[i];
+		appendFormatted(json, "%s\n    {\"operation\": \"%s\", \"calls\": %llu, \"sampled\": %llu, \"mean_ns\": %.1f, "
+		                "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}",
+		                i > 0 ? "," : "", operation.name, static_cast<unsigned long long>(operation.calls),
+		                static_cast<unsigned long long>(operation.sampled), operation.mean,
+		                static_cast<unsigned long long>(operation.p50), static_cast<unsigned long long>(operation.p99),
+		                static_cast<unsigned long long>(operation.p999), static_cast<unsigned long long>(operation.max));
+	}
+	json += "\n  ],\n  \"categories\": [";
+	for (size_t i = 0; i < report.categories.size(); i++) {
+		const CategoryReport& category = report.categories[i];
+		appendFormatted(json, "%s\n    {\"category\": \"%s\", \"items\": %zu, \"memory_bytes\": %llu}",
+		                i > 0 ? "," : "", category.name, category.itemCount, static_cast<unsigned long long>(category.memoryBytes));
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+// Prometheus text exposition format, latencies as summaries in seconds
+string metricsToPrometheus(const MetricsReport& report) {
+	string text;
+	if (report.enabled) {
+		text += "# HELP inventory_operations_total Calls of each inventory operation.\n";
+		text += "# TYPE inventory_operations_total counter\n";
+		for (const OperationReport& operation : report.operations) {
+			appendFormatted(text, "inventory_operations_total{operation=\"%s\"} %llu\n", operation.name, static_cast<unsigned long long>(operation.calls));
+		}
+		text += "# HELP inventory_operation_latency_seconds Sampled latency of each inventory operation.\n";
+		text += "# TYPE inventory_operation_latency_seconds summary\n";
+		for (const OperationReport& operation : report.operations) {
+			const pair<const char*, uint64_t> quantiles[] = {{"0.5", operation.p50}, {"0.99", operation.p99}, {"0.999", operation.p999}};
+			for (const auto& quantile : quantiles) {
+				if (operation.sampled == 0) {
+					appendFormatted(text, "inventory_operation_latency_seconds{operation=\"%s\",quantile=\"%s\"} NaN\n", operation.name, quantile.first);
+				} else {
+					appendFormatted(text, "inventory_operation_latency_seconds{operation=\"%s\",quantile=\"%s\"} %.9f\n",
+					                operation.name, quantile.first, quantile.second / 1e9);
+				}
+			}
+			appendFormatted(text, "inventory_operation_latency_seconds_sum{operation=\"%s\"} %.9f\n", operation.name, operation.mean * operation.sampled / 1e9);
+			appendFormatted(text, "inventory_operation_latency_seconds_count{operation=\"%s\"} %llu\n", operation.name, static_cast<unsigned long long>(operation.sampled));
+		}
+	}
+	text += "# HELP inventory_items Items stored in each category.\n";
+	text += "# TYPE inventory_items gauge\n";
+	for (const CategoryReport& category : report.categories) {
+		appendFormatted(text, "inventory_items{category=\"%s\"} %zu\n", category.name, category.itemCount);
+	}
+	text += "# HELP inventory_memory_bytes Estimated memory held by the items of each category.\n";
+	text += "# TYPE inventory_memory_bytes gauge\n";
+	for (const CategoryReport& category : report.categories) {
+		appendFormatted(text, "inventory_memory_bytes{category=\"%s\"} %llu\n", category.name, static_cast<unsigned long long>(category.memoryBytes));
+	}
+	return text;
+}
+
+bool saveMetrics(const string& path, const MetricsReport& report, string& error) {
+	bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+	string text = json ? metricsToJson(report) : metricsToPrometheus(report);
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		error = "Cannot open " + path;
+		return false;
+	}
+	bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+	if (fclose(file) != 0 || !written) {
+		error = "Cannot write " + path;
+		return false;
+	}
+	return true;
+}
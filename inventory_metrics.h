@@ -0,0 +1,156 @@
+// Operation counters and latency histograms of the inventory engine
+// Building with INVENTORY_METRICS=0 removes the instrumentation, the reports then only hold item counts and memory
+#ifndef INVENTORY_METRICS_H
+#define INVENTORY_METRICS_H
+
+#ifndef INVENTORY_METRICS
+#define INVENTORY_METRICS 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Engine operations with their own counter and histogram
+enum class MetricOperation : uint8_t {
+	Insert, Lookup, Update, Adjust, Remove, Search, Sort, CategoryListing, LowStock, Range,
+	Query, Valuation, SnapshotSave, SnapshotLoad, Import, Export, Batch
+};
+constexpr size_t metricOperationCount = 17;
+
+const char* getMetricOperationName(MetricOperation operation);
+
+// Log-linear latency histogram in nanoseconds like HdrHistogram, 16 buckets per power of two keep every value within 6%
+class LatencyHistogram {
+	private:
+		static const unsigned subBucketBits = 4;
+		static const size_t subBucketCount = size_t(1) << subBucketBits;
+		static const size_t bucketCount = (64 - subBucketBits + 1) * subBucketCount;
+
+		atomic<uint64_t> buckets[bucketCount] = {};
+		atomic<uint64_t> sampleCount{0};
+		atomic<uint64_t> totalNanoseconds{0};
+		atomic<uint64_t> maximum{0};
+
+		static size_t bucketOf(uint64_t nanoseconds);
+		static uint64_t bucketUpperBound(size_t bucket);
+
+	public:
+		void record(uint64_t nanoseconds);
+		uint64_t count() const {
+			return sampleCount.load(memory_order_relaxed);
+		}
+		uint64_t max() const {
+			return maximum.load(memory_order_relaxed);
+		}
+		double mean() const;
+		uint64_t percentile(double fraction) const; // Highest value in the bucket holding that fraction of the samples
+};
+
+// Per-operation call counts and sampled latencies, safe to record from any thread
+// Every live thread owns one row of counters, so counting a call is a plain add instead of a locked one
+// Threads beyond the owned rows share the last row and add atomically
+class OperationMetrics {
+	private:
+		static const size_t ownedRows = 64;
+		struct alignas(64) CounterRow {
+			atomic<uint64_t> calls[metricOperationCount] = {};
+		};
+		CounterRow rows[ownedRows + 1];
+		LatencyHistogram histograms[metricOperationCount];
+
+		// Row leased to the calling thread until it exits, leased on its first call
+		static const size_t unleasedRow = numeric_limits<size_t>::max();
+		static inline thread_local size_t leasedRow = unleasedRow;
+		static inline thread_local uint32_t hotCalls = 0;
+		static size_t leaseRow();
+
+	public:
+		static const uint32_t hotSampleInterval = 64; // Lookups and adjustments time one call in this many
+
+		// Counts the call and returns whether it should be timed
+		bool startCall(MetricOperation operation) {
+			size_t row = leasedRow != unleasedRow ? leasedRow : leaseRow();
+			atomic<uint64_t>& calls = rows[row].calls[static_cast<size_t>(operation)];
+			if (row < ownedRows) {
+				calls.store(calls.load(memory_order_relaxed) + 1, memory_order_relaxed); // Only this thread writes the row
+			} else {
+				calls.fetch_add(1, memory_order_relaxed);
+			}
+			if (operation != MetricOperation::Lookup && operation != MetricOperation::Adjust) {
+				return true;
+			}
+			return ++hotCalls % hotSampleInterval == 0;
+		}
+		void recordLatency(MetricOperation operation, uint64_t nanoseconds) {
+			histograms[static_cast<size_t>(operation)].record(nanoseconds);
+		}
+		uint64_t calls(MetricOperation operation) const;
+		const LatencyHistogram& histogram(MetricOperation operation) const {
+			return histograms[static_cast<size_t>(operation)];
+		}
+};
+
+// Times one operation from construction to destruction when its call is sampled
+class MetricTimer {
+	private:
+		OperationMetrics& metrics;
+		MetricOperation operation;
+		bool timed;
+		chrono::steady_clock::time_point started;
+
+	public:
+		MetricTimer(OperationMetrics& target, MetricOperation timedOperation)
+			: metrics(target), operation(timedOperation), timed(target.startCall(timedOperation)) {
+			if (timed) {
+				started = chrono::steady_clock::now();
+			}
+		}
+		MetricTimer(const MetricTimer&) = delete;
+		MetricTimer& operator=(const MetricTimer&) = delete;
+		~MetricTimer() {
+			if (timed) {
+				metrics.recordLatency(operation, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count());
+			}
+		}
+};
+
+#if INVENTORY_METRICS
+#define INVENTORY_METRIC(operation) MetricTimer metricTimer(metrics, MetricOperation::operation)
+#else
+#define INVENTORY_METRIC(operation) ((void)0)
+#endif
+
+// Copy of the metrics at one moment, latencies in nanoseconds
+struct OperationReport {
+	const char* name;
+	uint64_t calls;
+	uint64_t sampled; // Calls that were timed
+	double mean;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+struct CategoryReport {
+	const char* name;
+	size_t itemCount;
+	uint64_t memoryBytes; // Estimate covering the items, their columns and their index entries
+};
+
+struct MetricsReport {
+	bool enabled = INVENTORY_METRICS; // False when built without the instrumentation
+	vector<OperationReport> operations; // Only operations that were called
+	vector<CategoryReport> categories;
+};
+
+string metricsToJson(const MetricsReport& report);
+string metricsToPrometheus(const MetricsReport& report);
+bool saveMetrics(const string& path, const MetricsReport& report, string& error); // JSON for a .json path, Prometheus text otherwise
+
+#endif